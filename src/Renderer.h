@@ -3,7 +3,15 @@
 #include <GL/glew.h>
 
 #include "objLoader.h"
+#include "meshOptimizer.h"
 #include "shader.h"
+#include <array>
+#include <bit>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -11,99 +19,348 @@
 
 namespace Renderer {
 
+//index range of one simplified level in Mesh::EBO
+struct LodRange{
+  GLsizei indexOffset, indexCount;
+  float error; //model space deviation from full mesh
+};
+
 struct Mesh{
   GLuint VAO;
   GLuint VBO;
+  GLuint EBO = 0; //0 - drawn with glDrawArrays
   GLsizei indexCount;
   std::string material;
-  unsigned int textureID;
+  uint32_t materialId = 0; //index into Materials and MaterialTable, 0 - default
+  bool transparent = false; //material opacity below 1, drawn blended after opaque meshes
+  unsigned int textureID = 0;
   unsigned int state;  // 0 - just vertices;  1 - vertices and texture 2 - vertices and normals 3 - all
+  glm::mat4 dequantize = glm::mat4(1.0f); //quantized position to model space
+  bool octNormals = false; //normal attribute holds 2 octahedral components
+  meshOptimizer::VertexFormat vertexFormat = meshOptimizer::VertexFormat::Float;
+  std::vector<meshOptimizer::Meshlet> meshlets; //index ranges culled one by one, empty - whole mesh is drawn
+  std::vector<LodRange> lods; //coarser levels stored in EBO after full mesh
+  unsigned int lod = 0; //level drawn last frame, 0 - full mesh
+  GLint batchVertex = -1; //first vertex in SceneBatch buffers, -1 - not batched
+  GLuint batchIndex = 0; //first index in SceneBatch element buffer
+  GLuint batchTexture = 0; //SceneBatch texture array holding diffuse map, 0 - textureID is bound
+  GLint batchLayer = -1; //layer of diffuse map in batchTexture
+  glm::vec3 min = glm::vec3(0.0f), max = glm::vec3(0.0f); //model space AABB
 };
 
+//triangles submitted per LOD level, frustum culling and draw sorting counts, caller resets it every frame
+struct FrameStats{
+  static constexpr unsigned int maxLevels = 8; //deeper levels are counted in the last one
+  size_t triangles[maxLevels] = {};
+  size_t draws = 0; //meshes drawn
+  size_t drawCalls = 0; //GL draw calls issued
+  size_t multiDrawCalls = 0; //glMultiDrawElementsIndirect calls among drawCalls
+  size_t meshesTested = 0, meshesCulled = 0;
+  size_t stateChanges = 0, stateChangesUnsorted = 0; //material, texture and state switches, sorted vs collection order
+
+  void reset(){ *this = FrameStats(); }
+  size_t total() const{
+    size_t sum = 0;
+    for(size_t t : triangles) sum += t;
+    return sum;
+  }
+};
+
+//camera state RenderObject culls and picks LODs against, in model space of drawn models
+struct View{
+  glm::vec4 planes[6]; //left, right, bottom, top, near, far; inside when dot(plane, (p, 1)) >= 0
+  glm::vec3 position;
+  float pixelsPerUnit = 0.0f; //screen pixels covered by 1 unit at distance 1, 0 - LODs off
+  float pixelError = 1.0f; //allowed projected LOD error in pixels
+  float hysteresis = 0.25f; //coarser level is taken only below (1 - hysteresis) * pixelError
+  FrameStats* stats = nullptr;
+};
+
+//extracts frustum planes from projection * view * model (Gribb, Hartmann) and moves
+//camera position into model space. LOD selection needs viewportHeight in pixels.
+View makeView(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& position, const glm::mat4& model = glm::mat4(1.0f), float viewportHeight = 0.0f){
+  View v;
+  v.pixelsPerUnit = 0.5f * viewportHeight * projection[1][1];
+  glm::mat4 m = glm::transpose(projection * view * model);
+  v.planes[0] = m[3] + m[0];
+  v.planes[1] = m[3] - m[0];
+  v.planes[2] = m[3] + m[1];
+  v.planes[3] = m[3] - m[1];
+  v.planes[4] = m[3] + m[2];
+  v.planes[5] = m[3] - m[2];
+  for(glm::vec4& p : v.planes)
+    p /= glm::length(glm::vec3(p));
+  v.position = glm::vec3(glm::inverse(model) * glm::vec4(position, 1.0f));
+  return v;
+}
+
+inline bool sphereVisible(const View& view, const glm::vec3& center, float radius){
+  for(const glm::vec4& p : view.planes)
+    if(glm::dot(glm::vec3(p), center) + p.w < -radius) return false;
+  return true;
+}
+
+//box is outside when its corner furthest along plane normal is behind the plane
+inline bool boxVisible(const View& view, const glm::vec3& min, const glm::vec3& max){
+  for(const glm::vec4& p : view.planes){
+    glm::vec3 corner(p.x >= 0.0f ? max.x : min.x, p.y >= 0.0f ? max.y : min.y, p.z >= 0.0f ? max.z : min.z);
+    if(glm::dot(glm::vec3(p), corner) + p.w < 0.0f) return false;
+  }
+  return true;
+}
+
 struct Model{
   std::vector<Mesh> meshes;
+  meshOptimizer::OptimizeReport report; //vertex cache stats summed over meshes
+  glm::vec3 center = glm::vec3(0.0f); //bounding sphere of all meshes
+  float radius = 0.0f;
+  glm::vec3 min = glm::vec3(0.0f), max = glm::vec3(0.0f); //AABB of all meshes
 };
 
-unsigned int loadTexture(std::string path){
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
-    if (data){
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
+//AABB of interleaved position/normal/uv vertices, stays at origin when there are none
+void computeBounds(Mesh& mesh, const float* vertices, size_t floatCount){
+  if(floatCount < 8) return;
+  meshOptimizer::positionBounds(vertices, floatCount / 8, &mesh.min[0], &mesh.max[0]);
+}
 
-    return textureID;
+//model AABB and bounding sphere around AABBs of its non empty meshes
+void computeBounds(Model& model){
+  glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+  for(const Mesh& mesh : model.meshes){
+    if(mesh.indexCount == 0) continue;
+    lo = glm::min(lo, mesh.min);
+    hi = glm::max(hi, mesh.max);
+  }
+  if(lo.x > hi.x) return;
+  model.min = lo;
+  model.max = hi;
+  model.center = (lo + hi) * 0.5f;
+  model.radius = glm::length(hi - lo) * 0.5f;
 }
 
-Model LoadObject(objLoader::Object Object, std::vector<objLoader::Material>& Materials){
-  Model model;
-  for(const objLoader::Mesh& mesh : Object.meshes) {
-    Mesh gpuMesh;
-    gpuMesh.state = 0;
-    if(Object.texCoords.size() > 0) gpuMesh.state+=1; 
-    if(Object.normals.size() > 0) gpuMesh.state+=2; 
+//material parameters in std140 layout of fs.glsl MaterialData
+struct GpuMaterial{
+  float ambient[3];
+  float shininess;
+  float diffuse[3];
+  float opacity;
+  float specular[3];
+  float pad;
+};
+static_assert(sizeof(GpuMaterial) == 48, "GpuMaterial should match std140 MaterialData");
 
-    glGenVertexArrays(1, &gpuMesh.VAO);
-    glGenBuffers(1, &gpuMesh.VBO);
+//uniform buffer with every material, meshes pick theirs through materialId uniform
+struct MaterialTable{
+  static constexpr unsigned int maxMaterials = 256; //MAX_MATERIALS in fs.glsl
+  static constexpr GLuint binding = 0; //uniform block binding point
+  GLuint UBO = 0;
+  size_t count = 0;
+};
 
-    glBindVertexArray(gpuMesh.VAO);
+//dense id of material name (its index in Materials), unknown names and ones past limit get 0 as before
+uint32_t materialIndex(const std::vector<objLoader::Material>& Materials, const std::string& name, size_t limit = MaterialTable::maxMaterials){
+  for(size_t i=0; i<Materials.size() && i<limit; i++)
+    if(Materials[i].name == name) return static_cast<uint32_t>(i);
+  return 0;
+}
 
-    std::vector<float> interleaved;
-    interleaved.reserve(mesh.positions.size() * 8);
-
-    for (size_t i = 0; i < mesh.positions.size(); i++){
-      unsigned int v = mesh.positions[i];
-      unsigned int n = (i < mesh.normPositions.size()) ? mesh.normPositions[i] : 0;
-      unsigned int t = (i < mesh.texPositions.size()) ? mesh.texPositions[i] : 0;
-      interleaved.push_back(Object.vertices[v * 3 + 0]);
-      interleaved.push_back(Object.vertices[v * 3 + 1]);
-      interleaved.push_back(Object.vertices[v * 3 + 2]);
-
-      if (!Object.normals.empty()) {
-        interleaved.push_back(Object.normals[n * 3 + 0]);
-        interleaved.push_back(Object.normals[n * 3 + 1]);
-        interleaved.push_back(Object.normals[n * 3 + 2]);
-      } else {
-        interleaved.push_back(0.0f);
-        interleaved.push_back(1.0f);
-        interleaved.push_back(0.0f);
-      }
-      if (!Object.texCoords.empty()) {
-        interleaved.push_back(Object.texCoords[t * 3 + 0]);
-        interleaved.push_back(Object.texCoords[t * 3 + 1]);
-      } else {
-        interleaved.push_back(0.0f);
-        interleaved.push_back(1.0f);
-      }
+//packs Materials into uniform buffer bound at MaterialTable::binding, shader's
+//MaterialBlock has to be assigned to that binding (glUniformBlockBinding)
+MaterialTable createMaterialTable(const std::vector<objLoader::Material>& Materials){
+  MaterialTable table;
+  table.count = std::min<size_t>(Materials.size(), MaterialTable::maxMaterials);
+  if(Materials.size() > MaterialTable::maxMaterials)
+    std::cout << "Too many materials (" << Materials.size() << "), meshes using the ones past " << MaterialTable::maxMaterials << " get the default" << std::endl;
+  std::vector<GpuMaterial> data(MaterialTable::maxMaterials);
+  for(size_t i=0; i<table.count; i++){
+    const objLoader::Material& m = Materials[i];
+    GpuMaterial& g = data[i];
+    std::copy_n(m.ambient, 3, g.ambient);
+    std::copy_n(m.diffuse, 3, g.diffuse);
+    std::copy_n(m.specular, 3, g.specular);
+    g.shininess = m.sExponent;
+    g.opacity = m.opacity;
+    g.pad = 0.0f;
+  }
+  glGenBuffers(1, &table.UBO);
+  glBindBuffer(GL_UNIFORM_BUFFER, table.UBO);
+  glBufferData(GL_UNIFORM_BUFFER, data.size() * sizeof(GpuMaterial), data.data(), GL_STATIC_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER, MaterialTable::binding, table.UBO);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  return table;
+}
+
+void DestroyMaterialTable(MaterialTable& table){
+  if(table.UBO) glDeleteBuffers(1, &table.UBO);
+  table = MaterialTable();
+}
+
+//coarsest level whose error projected at distance stays within view.pixelError.
+//Starts from level drawn last frame and goes coarser only below (1 - hysteresis) of
+//the budget, so meshes near a switching distance don't pop every frame.
+unsigned int selectLod(const Mesh& mesh, const View& view, float distance){
+  if(view.pixelsPerUnit <= 0.0f || mesh.lods.empty()) return 0;
+  float scale = view.pixelsPerUnit / std::max(distance, 1e-4f);
+  unsigned int level = std::min<unsigned int>(mesh.lod, static_cast<unsigned int>(mesh.lods.size()));
+  auto projected = [&](unsigned int l){ return l == 0 ? 0.0f : mesh.lods[l - 1].error * scale; };
+  while(level < mesh.lods.size() && projected(level + 1) <= view.pixelError * (1.0f - view.hysteresis))
+    level++;
+  while(level > 0 && projected(level) > view.pixelError)
+    level--;
+  return level;
+}
+
+//------------------ textures
+
+//stbi_load output, freed once uploaded
+struct DecodedImage{
+  unsigned char* data = nullptr;
+  int width = 0, height = 0, components = 0;
+};
+
+//GL textures shared by all meshes, keyed by normalized path. decodeTextures decodes every
+//unique image once on worker threads while meshes are still processed, the GL thread uploads
+//them on first lookup. Decoder holds a reference to the cache, so it can't be copied or moved.
+struct TextureCache{
+  std::unordered_map<std::string, GLuint> ids; //0 - failed to load
+  std::vector<std::string> pending; //scheduled for decoding, not uploaded yet
+  std::vector<DecodedImage> images; //pixels of pending[i]
+  std::thread decoder;
+  size_t loaded = 0, lookups = 0; //unique images uploaded, meshes asking for one
+
+  TextureCache() = default;
+  TextureCache(const TextureCache&) = delete;
+  TextureCache& operator=(const TextureCache&) = delete;
+  //waits for decoder and frees pixels never uploaded, GL textures are left to DestroyTextures
+  ~TextureCache(){
+    if(decoder.joinable()) decoder.join();
+    for(DecodedImage& image : images)
+      if(image.data) stbi_image_free(image.data);
+  }
+};
+
+//backslashes of Windows exported mtl files become '/', "./" and "dir/../" are collapsed,
+//so one file referenced in different ways is decoded once
+std::string normalizeTexturePath(std::string path){
+  for(char& c : path)
+    if(c == '\\') c = '/';
+  return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+//creates mipmapped texture from image, 0 if it has no pixels
+GLuint uploadTexture(const DecodedImage& image){
+  if(!image.data) return 0;
+  GLenum format = GL_RGBA;
+  if (image.components == 1)
+      format = GL_RED;
+  else if (image.components == 2)
+      format = GL_RG;
+  else if (image.components == 3)
+      format = GL_RGB;
+
+  GLuint textureID;
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1); //rows of stbi_load output are not padded
+  glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glGenerateMipmap(GL_TEXTURE_2D);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  return textureID;
+}
+
+//decodes and uploads one image on calling thread, meshes go through TextureCache
+unsigned int loadTexture(std::string path){
+  DecodedImage image;
+  image.data = stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0);
+  if(!image.data){
+    std::cout << "Texture failed to load at path: " << path << std::endl;
+    return 0;
+  }
+  GLuint textureID = uploadTexture(image);
+  stbi_image_free(image.data);
+  return textureID;
+}
+
+//starts decoding diffuse maps of Materials not in cache yet on a background thread
+//(threads workers, 0 - all cores) and returns right away, no GL calls are made
+void decodeTextures(TextureCache& cache, const std::vector<objLoader::Material>& Materials, unsigned int threads = 0){
+  if(cache.decoder.joinable()) cache.decoder.join();
+  size_t first = cache.pending.size();
+  for(const objLoader::Material& mtl : Materials){
+    if(mtl.DiffuseMap.empty()) continue;
+    std::string key = normalizeTexturePath(mtl.DiffuseMap);
+    if(cache.ids.emplace(key, 0).second) cache.pending.push_back(key);
+  }
+  cache.images.resize(cache.pending.size());
+  if(first == cache.pending.size()) return;
+  cache.decoder = std::thread([&cache, first, threads](){
+    meshOptimizer::parallelFor(cache.pending.size() - first, threads, [&](size_t i){
+      DecodedImage& image = cache.images[first + i];
+      image.data = stbi_load(cache.pending[first + i].c_str(), &image.width, &image.height, &image.components, 0);
+    });
+  });
+}
+
+//waits for decoder and uploads everything it decoded, GL thread only
+void uploadTextures(TextureCache& cache){
+  if(cache.decoder.joinable()) cache.decoder.join();
+  for(size_t i=0; i<cache.pending.size(); i++){
+    DecodedImage& image = cache.images[i];
+    if(!image.data){ //stays 0, so lookups don't decode it again
+      std::cout << "Texture failed to load at path: " << cache.pending[i] << std::endl;
+      continue;
     }
-        
-    glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.VBO);
-    glBufferData(GL_ARRAY_BUFFER, interleaved.size() * sizeof(float), interleaved.data(), GL_STATIC_DRAW);
+    cache.ids[cache.pending[i]] = uploadTexture(image);
+    cache.loaded++;
+    stbi_image_free(image.data);
+  }
+  cache.pending.clear();
+  cache.images.clear();
+}
 
+//shared texture for path, images decodeTextures didn't schedule are loaded here once.
+//Images that failed to load are reported once and give 0 from then on.
+GLuint textureFor(TextureCache& cache, const std::string& path){
+  if(!cache.pending.empty()) uploadTextures(cache);
+  cache.lookups++;
+  std::string key = normalizeTexturePath(path);
+  auto found = cache.ids.find(key);
+  if(found != cache.ids.end()) return found->second;
+  GLuint textureID = loadTexture(key);
+  cache.ids.emplace(key, textureID);
+  cache.loaded += textureID != 0;
+  return textureID;
+}
+
+void DestroyTextures(TextureCache& cache){
+  if(cache.decoder.joinable()) cache.decoder.join();
+  for(DecodedImage& image : cache.images)
+    if(image.data) stbi_image_free(image.data);
+  for(auto& entry : cache.ids)
+    if(entry.second) glDeleteTextures(1, &entry.second);
+  cache.ids.clear();
+  cache.pending.clear();
+  cache.images.clear();
+  cache.loaded = cache.lookups = 0;
+}
+
+//------------------ meshes
+
+//bytes per vertex of format, as meshOptimizer::quantizeMesh lays it out
+inline GLsizei vertexStride(meshOptimizer::VertexFormat format){
+  using meshOptimizer::VertexFormat;
+  return format == VertexFormat::Float ? 32 : format == VertexFormat::Oct8 ? 12 : 16;
+}
+
+//attributes of bound VAO for vertices of format in bound GL_ARRAY_BUFFER
+void setVertexAttributes(meshOptimizer::VertexFormat format){
+  using meshOptimizer::VertexFormat;
+  if(format == VertexFormat::Float){
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
     
@@ -112,69 +369,700 @@ Model LoadObject(objLoader::Object Object, std::vector<objLoader::Material>& Mat
     
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6*sizeof(float)));
     glEnableVertexAttribArray(2);
+    return;
+  }
+  GLsizei stride = vertexStride(format);
+  size_t normalOffset = format == VertexFormat::Oct8 ? 6 : 8, uvOffset = format == VertexFormat::Oct8 ? 8 : 12;
 
-    gpuMesh.indexCount = static_cast<GLsizei>(mesh.positions.size());
-    gpuMesh.material = mesh.mtl;
+  glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)0);
+  glEnableVertexAttribArray(0);
 
-    if(gpuMesh.state == 1 || gpuMesh.state == 3){
-      objLoader::Material mtl = Materials[0]; 
+  if(format == VertexFormat::Packed1010102)
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)normalOffset);
+  else
+    glVertexAttribPointer(1, 2, format == VertexFormat::Oct16 ? GL_SHORT : GL_BYTE, GL_TRUE, stride, (void*)normalOffset);
+  glEnableVertexAttribArray(1);
 
-      for(const objLoader::Material& mat : Materials){
-        if(gpuMesh.material == mat.name){
-          mtl=mat;
-          break;
-        } 
-      }
-      if(mtl.DiffuseMap != ""){
-        int pos = 0;
-        while ((pos = mtl.DiffuseMap.find("\\\\", pos)) != std::string::npos)
-          mtl.DiffuseMap.replace(pos, 2, "/");
-        gpuMesh.textureID = loadTexture(mtl.DiffuseMap);
-      }
+  glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)uvOffset);
+  glEnableVertexAttribArray(2);
+}
+
+//uploads interleaved position/normal/uv vertices to bound VAO's buffer
+void uploadVertices(Mesh& gpuMesh, const float* vertices, size_t floatCount){
+  glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.VBO);
+  glBufferData(GL_ARRAY_BUFFER, floatCount * sizeof(float), vertices, GL_STATIC_DRAW);
+  setVertexAttributes(meshOptimizer::VertexFormat::Float);
+  gpuMesh.vertexFormat = meshOptimizer::VertexFormat::Float;
+}
+
+//uploads meshOptimizer::quantizeMesh output and sets attributes for its format
+void uploadQuantized(Mesh& gpuMesh, const meshOptimizer::QuantizedMesh& quantized){
+  using meshOptimizer::VertexFormat;
+  if(quantized.format == VertexFormat::Float){
+    uploadVertices(gpuMesh, reinterpret_cast<const float*>(quantized.vertices.data()), quantized.vertices.size() / sizeof(float));
+    return;
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.VBO);
+  glBufferData(GL_ARRAY_BUFFER, quantized.vertices.size(), quantized.vertices.data(), GL_STATIC_DRAW);
+  setVertexAttributes(quantized.format);
+
+  gpuMesh.vertexFormat = quantized.format;
+  gpuMesh.dequantize = quantized.dequantize;
+  gpuMesh.octNormals = quantized.format != VertexFormat::Packed1010102;
+}
+
+//resolves gpuMesh.material to materialId and transparency, takes its diffuse map from textures
+void loadMeshTexture(Mesh& gpuMesh, std::vector<objLoader::Material>& Materials, TextureCache& textures){
+  //materials past MaterialTable's size are drawn with default parameters, but keep their own texture
+  uint32_t index = materialIndex(Materials, gpuMesh.material, Materials.size());
+  gpuMesh.materialId = index < MaterialTable::maxMaterials ? index : 0;
+  gpuMesh.transparent = !Materials.empty() && Materials[index].opacity < 1.0f;
+  if((gpuMesh.state == 1 || gpuMesh.state == 3) && !Materials.empty()){
+    const objLoader::Material& mtl = Materials[index];
+    if(!mtl.DiffuseMap.empty())
+      gpuMesh.textureID = textureFor(textures, mtl.DiffuseMap);
+  }
+}
+
+//welding, optimization, quantization and bounds run for all meshes in parallel
+//(options.threads), the GL thread then only creates buffers and uploads. Textures come
+//from textures, shared with other models
+Model LoadObject(const objLoader::Object& Object, std::vector<objLoader::Material>& Materials, TextureCache& textures, const meshOptimizer::OptimizeOptions& options = meshOptimizer::OptimizeOptions()){
+  Model model;
+  size_t count = Object.meshes.size();
+  std::vector<meshOptimizer::IndexedMesh> meshes(count);
+  meshOptimizer::parallelFor(count, options.threads, [&](size_t i){
+    meshes[i] = meshOptimizer::buildIndexed(Object, Object.meshes[i]);
+  });
+  for(const meshOptimizer::OptimizeReport& r : meshOptimizer::optimizeMeshes(meshes, options))
+    model.report += r;
+
+  std::vector<meshOptimizer::QuantizedMesh> quantized(options.vertexFormat == meshOptimizer::VertexFormat::Float ? 0 : count);
+  model.meshes.resize(count);
+  meshOptimizer::parallelFor(count, options.threads, [&](size_t i){
+    const meshOptimizer::IndexedMesh& indexed = meshes[i];
+    Mesh& gpuMesh = model.meshes[i];
+    gpuMesh.state = indexed.state;
+    gpuMesh.material = indexed.mtl;
+    gpuMesh.indexCount = static_cast<GLsizei>(indexed.indices.size());
+    gpuMesh.meshlets = indexed.meshlets;
+    size_t offset = indexed.indices.size();
+    for(const meshOptimizer::LodLevel& lod : indexed.lods){
+      gpuMesh.lods.push_back({static_cast<GLsizei>(offset), static_cast<GLsizei>(lod.indices.size()), lod.error});
+      offset += lod.indices.size();
     }
+    computeBounds(gpuMesh, indexed.vertices.data(), indexed.vertices.size());
+    if(!quantized.empty())
+      quantized[i] = meshOptimizer::quantizeMesh(indexed, options.vertexFormat);
+  });
+  computeBounds(model);
+
+  for(size_t i=0; i<count; i++) {
+    const meshOptimizer::IndexedMesh& indexed = meshes[i];
+    Mesh& gpuMesh = model.meshes[i];
+
+    glGenVertexArrays(1, &gpuMesh.VAO);
+    glGenBuffers(1, &gpuMesh.VBO);
+    glGenBuffers(1, &gpuMesh.EBO);
+
+    glBindVertexArray(gpuMesh.VAO);
+    if(quantized.empty())
+      uploadVertices(gpuMesh, indexed.vertices.data(), indexed.vertices.size());
+    else
+      uploadQuantized(gpuMesh, quantized[i]);
+    size_t indexTotal = indexed.indices.size();
+    for(const meshOptimizer::LodLevel& lod : indexed.lods)
+      indexTotal += lod.indices.size();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexTotal * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indexed.indices.size() * sizeof(unsigned int), indexed.indices.data());
+    for(size_t l=0; l<indexed.lods.size(); l++)
+      glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.lods[l].indexOffset * sizeof(unsigned int), indexed.lods[l].indices.size() * sizeof(unsigned int), indexed.lods[l].indices.data());
+
+    loadMeshTexture(gpuMesh, Materials, textures);
+
+    glBindVertexArray(0);
+  }
+  return model;
+}
+
+//uploads batches from objLoader::loadInterleaved as they are, one mesh per material
+Model LoadInterleaved(const objLoader::InterleavedObject& Object, std::vector<objLoader::Material>& Materials, TextureCache& textures){
+  Model model;
+  for(const objLoader::InterleavedBatch& batch : Object.batches) {
+    Mesh gpuMesh;
+    gpuMesh.state = batch.state;
+    gpuMesh.textureID = 0;
+
+    glGenVertexArrays(1, &gpuMesh.VAO);
+    glGenBuffers(1, &gpuMesh.VBO);
+
+    glBindVertexArray(gpuMesh.VAO);
+    uploadVertices(gpuMesh, batch.vertices.data(), batch.vertices.size());
+
+    gpuMesh.indexCount = static_cast<GLsizei>(batch.vertices.size() / 8);
+    computeBounds(gpuMesh, batch.vertices.data(), batch.vertices.size());
+    gpuMesh.material = batch.mtl;
+    loadMeshTexture(gpuMesh, Materials, textures);
 
     model.meshes.push_back(gpuMesh);
 
     glBindVertexArray(0);
   }
+  computeBounds(model);
   return model;
 }
 
-void RenderObject(Model& model, Shader& shader, GLint* SetMesh, std::vector<objLoader::Material>& Materials){
-  glUseProgram(shader.ID);
-    
-  for(const Mesh& mesh : model.meshes) {
-    objLoader::Material mtl = Materials[0]; //Default
+//ranges of one glMultiDrawElements, caller keeps it so capacity is reused between meshes
+struct MeshletDraws{
+  std::vector<GLsizei> counts;
+  std::vector<const void*> offsets;
+};
 
-    for(const objLoader::Material& mat : Materials){
-      if(mat.name == mesh.material){
-        mtl=mat;
-        break;
-      } 
+//draws visible meshlet ranges of mesh, neighbouring ranges are merged into one draw.
+//Backfacing clusters are skipped only while GL_CULL_FACE is on.
+size_t drawMeshlets(const Mesh& mesh, const View& view, bool backfaceCull, MeshletDraws& draws){
+  std::vector<GLsizei>& counts = draws.counts;
+  std::vector<const void*>& offsets = draws.offsets;
+  counts.clear();
+  offsets.clear();
+  unsigned int end = ~0u;
+  for(const meshOptimizer::Meshlet& m : mesh.meshlets){
+    if(!sphereVisible(view, m.center, m.radius)) continue;
+    if(backfaceCull && meshOptimizer::meshletBackfacing(m, view.position)) continue;
+    if(m.indexOffset == end) counts.back() += m.indexCount;
+    else{
+      counts.push_back(m.indexCount);
+      offsets.push_back((const void*)(m.indexOffset * sizeof(unsigned int)));
     }
-  // 0 - just vertices;  1 - vertices and textures 2 - vertices and normals 3 - all
+    end = m.indexOffset + m.indexCount;
+  }
+  size_t drawn = 0;
+  for(GLsizei c : counts) drawn += c;
+  if(!counts.empty())
+    glMultiDrawElements(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(), static_cast<GLsizei>(counts.size()));
+  return drawn;
+}
 
-    glUniform3f(SetMesh[0], mtl.ambient[0], mtl.ambient[1], mtl.ambient[2] );
-    glUniform3f(SetMesh[1], mtl.diffuse[0], mtl.diffuse[1], mtl.diffuse[2] );
-    glUniform3f(SetMesh[2], mtl.specular[0], mtl.specular[1], mtl.specular[2] );
-    glUniform1f(SetMesh[3], mtl.sExponent); 
-    
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, mesh.textureID);
-    glUniform1i(SetMesh[4], 0);
+//------------------ draw list
+
+//visible meshes of a frame, draws are issued in order of their keys (see drawKey)
+struct DrawList{
+  std::vector<uint64_t> keys;
+  std::vector<Mesh*> meshes;
+  std::vector<uint32_t> order; //draw indices sorted by key
+  std::vector<uint64_t> keyScratch;
+  std::vector<uint32_t> orderScratch;
+  MeshletDraws meshletDraws; //drawMeshlets scratch of submitDraws
 
-    glUniform1i(SetMesh[5], mesh.state);
+  void clear(){
+    keys.clear();
+    meshes.clear();
+    order.clear();
+  }
+};
+
+//opaque:      pass 0 | state(2) texture(16) material(8) | unused(13) | depth(24) front to back
+//transparent: pass 1 | depth(24) back to front | state(2) texture(16) material(8) | unused(13)
+//Opaque draws group by binds, transparent ones keep painter's order. Meshes in SceneBatch
+//group by texture array instead of texture.
+inline uint64_t drawKey(const Mesh& mesh, float depth){
+  uint64_t d = std::bit_cast<uint32_t>(std::max(depth, 0.0f)) >> 8; //positive floats order as integers
+  unsigned int texture = mesh.batchTexture ? mesh.batchTexture : mesh.textureID;
+  uint64_t binds = uint64_t(mesh.state & 3) << 24 | uint64_t(texture & 0xFFFF) << 8 | (mesh.materialId & 0xFF);
+  if(!mesh.transparent) return binds << 37 | d;
+  return 1ull << 63 | (0xFFFFFF - d) << 39 | binds << 13;
+}
+
+//LSD radix sort of keys carrying values along, 8 bits per pass. Passes where all keys
+//share the byte are skipped. Inputs of 4 chunks and more are counted and scattered
+//chunk by chunk on meshOptimizer::threadPool(), so the sort stays stable; below that
+//handing chunks to workers costs more than the pass, so they are sorted serially.
+void radixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, std::vector<uint64_t>& keyScratch, std::vector<uint32_t>& valueScratch, unsigned int threads = 0){
+  constexpr size_t chunk = 1 << 14;
+  size_t n = keys.size();
+  if(n < 2) return;
+  if(n < chunk * 4) threads = 1;
+  keyScratch.resize(n);
+  valueScratch.resize(n);
+  size_t chunks = (n + chunk - 1) / chunk;
+  std::vector<std::array<uint32_t, 256>> counts(chunks);
+  for(int shift=0; shift<64; shift += 8){
+    meshOptimizer::parallelFor(chunks, threads, [&](size_t c){
+      counts[c].fill(0);
+      for(size_t i=c * chunk; i<std::min(n, (c + 1) * chunk); i++)
+        counts[c][(keys[i] >> shift) & 0xFF]++;
+    });
+    //digit is shared when one bucket holds all keys summed over chunks
+    bool trivial = false;
+    for(int b=0; b<256 && !trivial; b++){
+      size_t total = 0;
+      for(size_t c=0; c<chunks; c++) total += counts[c][b];
+      trivial = total == n;
+    }
+    if(trivial) continue;
+    uint32_t sum = 0;
+    for(int b=0; b<256; b++)
+      for(size_t c=0; c<chunks; c++){
+        uint32_t count = counts[c][b];
+        counts[c][b] = sum;
+        sum += count;
+      }
+    meshOptimizer::parallelFor(chunks, threads, [&](size_t c){
+      for(size_t i=c * chunk; i<std::min(n, (c + 1) * chunk); i++){
+        uint32_t at = counts[c][(keys[i] >> shift) & 0xFF]++;
+        keyScratch[at] = keys[i];
+        valueScratch[at] = values[i];
+      }
+    });
+    keys.swap(keyScratch);
+    values.swap(valueScratch);
+  }
+}
+
+//adds meshes of model that pass frustum test, picking their LOD level on the way.
+//Without view every mesh is added at full detail.
+void collectDraws(DrawList& list, Model& model, const View* view = nullptr){
+  if(view && !boxVisible(*view, model.min, model.max)){
+    if(view->stats){
+      view->stats->meshesTested += model.meshes.size();
+      view->stats->meshesCulled += model.meshes.size();
+    }
+    return;
+  }
+  float distance = view ? glm::length(model.center - view->position) - model.radius : 0.0f;
+  for(Mesh& mesh : model.meshes){
+    float depth = 0.0f;
+    if(view){
+      bool visible = model.meshes.size() == 1 || boxVisible(*view, mesh.min, mesh.max);
+      if(view->stats){
+        view->stats->meshesTested++;
+        view->stats->meshesCulled += !visible;
+      }
+      if(!visible) continue;
+      depth = glm::length((mesh.min + mesh.max) * 0.5f - view->position);
+    }
+    mesh.lod = view ? selectLod(mesh, *view, distance) : 0;
+    list.keys.push_back(drawKey(mesh, depth));
+    list.meshes.push_back(&mesh);
+  }
+}
+
+void sortDraws(DrawList& list, unsigned int threads = 0){
+  list.order.resize(list.keys.size());
+  for(uint32_t i=0; i<list.order.size(); i++) list.order[i] = i;
+  radixSort(list.keys, list.order, list.keyScratch, list.orderScratch, threads);
+}
+
+//material, texture and state switches when meshes are drawn in given order
+template<typename Order>
+size_t countStateChanges(const DrawList& list, size_t count, Order order){
+  size_t changes = 0;
+  for(size_t i=1; i<count; i++){
+    const Mesh& a = *list.meshes[order(i - 1)];
+    const Mesh& b = *list.meshes[order(i)];
+    changes += (a.materialId != b.materialId) + (a.textureID != b.textureID) + (a.state != b.state);
+  }
+  return changes;
+}
+
+//issues draws in list.order. Transparent meshes are blended without depth writes.
+//Meshlets outside frustum or facing away are not drawn. SetMesh holds locations of
+//materialId, diffuseM, state, dequantize and octNormals.
+void submitDraws(DrawList& list, Shader& shader, GLint* SetMesh, const View* view = nullptr){
+  if(list.order.empty()) return;
+  glUseProgram(shader.ID);
+  bool backfaceCull = view && glIsEnabled(GL_CULL_FACE);
+  glActiveTexture(GL_TEXTURE0);
+  glUniform1i(SetMesh[1], 0);
+
+  //uniforms and texture are set only when they differ from previous draw
+  uint32_t materialId = ~0u;
+  unsigned int textureID = ~0u, state = ~0u;
+  int octNormals = -1;
+  bool blending = false;
+  for(uint32_t index : list.order) {
+    const Mesh& mesh = *list.meshes[index];
+    if(mesh.transparent != blending){
+      blending = mesh.transparent;
+      if(blending){
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE);
+      }
+      else{
+        glDisable(GL_BLEND);
+        glDepthMask(GL_TRUE);
+      }
+    }
+    if(mesh.materialId != materialId) glUniform1i(SetMesh[0], materialId = mesh.materialId);
+    if(mesh.textureID != textureID) glBindTexture(GL_TEXTURE_2D, textureID = mesh.textureID);
+  // 0 - just vertices;  1 - vertices and textures 2 - vertices and normals 3 - all
+    if(mesh.state != state) glUniform1i(SetMesh[2], state = mesh.state);
+    glUniformMatrix4fv(SetMesh[3], 1, GL_FALSE, &mesh.dequantize[0][0]);
+    if(int(mesh.octNormals) != octNormals) glUniform1i(SetMesh[4], octNormals = mesh.octNormals);
     
     glBindVertexArray(mesh.VAO);
-    glDrawArrays(GL_TRIANGLES, 0, mesh.indexCount);
+    size_t drawn = mesh.indexCount;
+    if(mesh.lod > 0){
+      const LodRange& range = mesh.lods[mesh.lod - 1];
+      glDrawElements(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT, (void*)(range.indexOffset * sizeof(unsigned int)));
+      drawn = range.indexCount;
+    }
+    else if(mesh.EBO && view && !mesh.meshlets.empty())
+      drawn = drawMeshlets(mesh, *view, backfaceCull, list.meshletDraws);
+    else if(mesh.EBO)
+      glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+    else
+      glDrawArrays(GL_TRIANGLES, 0, mesh.indexCount);
     glBindVertexArray(0);
+
+    if(view && view->stats){
+      view->stats->triangles[std::min(mesh.lod, FrameStats::maxLevels - 1)] += drawn / 3;
+      view->stats->draws++;
+      view->stats->drawCalls += drawn > 0;
+    }
+  }
+  if(blending){
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+  }
+  if(view && view->stats){
+    size_t n = list.order.size();
+    view->stats->stateChanges += countStateChanges(list, n, [&](size_t i){ return list.order[i]; });
+    view->stats->stateChangesUnsorted += countStateChanges(list, n, [](size_t i){ return i; });
   }
 }
 
+//draws one model through caller's draw list, which is cleared first. With view, models and
+//meshes whose AABB is outside frustum are skipped before any GL call and every mesh draws
+//LOD level picked from distance to model's bounding sphere, see collectDraws and submitDraws.
+void RenderObject(Model& model, DrawList& list, Shader& shader, GLint* SetMesh, const View* view = nullptr){
+  list.clear();
+  collectDraws(list, model, view);
+  sortDraws(list, 1);
+  submitDraws(list, shader, SetMesh, view);
+}
+
+//------------------ multi draw indirect
+
+//record glMultiDrawElementsIndirect reads
+struct DrawElementsIndirectCommand{
+  GLuint count, instanceCount, firstIndex;
+  GLint baseVertex;
+  GLuint baseInstance;
+};
+
+//per draw data in std430 layout of vs_mdi.glsl DrawData, read at drawOffset + gl_DrawID
+struct GpuDraw{
+  float dequantize[16];
+  int32_t materialId, state, octNormals;
+  int32_t layer; //layer in texture array of call, -1 - diffuse map is bound as GL_TEXTURE_2D
+};
+static_assert(sizeof(GpuDraw) == 80, "GpuDraw should match std430 DrawData");
+
+//meshes of whole scene in shared vertex and element buffers and their diffuse maps in
+//texture arrays, visible ones are drawn with one glMultiDrawElementsIndirect per texture
+//array and pass (see submitBatch)
+struct SceneBatch{
+  static constexpr GLuint drawBinding = 1; //shader storage binding of vs_mdi.glsl DrawBlock
+  GLuint VAO = 0, VBO = 0, EBO = 0;
+  GLuint commandBuffer = 0, drawBuffer = 0;
+  meshOptimizer::VertexFormat format = meshOptimizer::VertexFormat::Float;
+  size_t meshes = 0; //meshes in batch
+  //run of commands sharing textures and pass, one glMultiDrawElementsIndirect
+  struct Call{
+    static constexpr GLuint unbound = ~0u; //no mesh of run samples it
+    size_t first, count;
+    GLuint texture, array; //GL_TEXTURE_2D on unit 0, GL_TEXTURE_2D_ARRAY on unit 1
+    bool transparent;
+  };
+  std::vector<DrawElementsIndirectCommand> commands; //rebuilt every frame
+  std::vector<GpuDraw> draws;
+  std::vector<Call> calls;
+  std::vector<GLuint> textures; //texture arrays, one per size and format of diffuse maps
+  DrawList unbatched; //meshes left out of batch, drawn through submitDraws
+};
+
+//indirect multi draw needs GL 4.3, gl_DrawID in vertex shader ARB_shader_draw_parameters
+//(both are there on Mesa llvmpipe, so it runs headless too)
+inline bool multiDrawSupported(){
+  return GLEW_VERSION_4_3 && GLEW_ARB_shader_draw_parameters;
+}
+
+//copies vertex and element buffers of every mesh into shared ones on GPU and frees mesh's
+//own buffers and VAO, so geometry isn't kept twice. Meshes remember their place
+//(batchVertex, batchIndex) and are drawn only through submitBatch from then on. All meshes
+//have to share vertex format, ones that differ from first mesh are left out, reported
+//and keep their buffers. Meshes without element buffer (LoadInterleaved) get sequential indices.
+SceneBatch buildSceneBatch(std::vector<Model>& models){
+  SceneBatch batch;
+  struct Source{
+    Mesh* mesh;
+    GLint vertexBytes, indices;
+  };
+  std::vector<Source> sources;
+  size_t vertexBytes = 0, indexTotal = 0, skipped = 0;
+  for(Model& model : models)
+    for(Mesh& mesh : model.meshes){
+      mesh.batchVertex = -1;
+      if(sources.empty() && !skipped) batch.format = mesh.vertexFormat;
+      if(mesh.vertexFormat != batch.format){
+        skipped++;
+        continue;
+      }
+      Source src{&mesh, 0, mesh.indexCount};
+      glBindBuffer(GL_COPY_READ_BUFFER, mesh.VBO);
+      glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &src.vertexBytes);
+      if(mesh.EBO){
+        GLint bytes = 0;
+        glBindBuffer(GL_COPY_READ_BUFFER, mesh.EBO);
+        glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &bytes);
+        src.indices = bytes / sizeof(unsigned int); //LOD levels come along
+      }
+      mesh.batchVertex = static_cast<GLint>(vertexBytes / vertexStride(batch.format));
+      mesh.batchIndex = static_cast<GLuint>(indexTotal);
+      vertexBytes += src.vertexBytes;
+      indexTotal += src.indices;
+      sources.push_back(src);
+    }
+  if(skipped)
+    std::cout << skipped << " meshes left out of scene batch, their vertex format differs" << std::endl;
+  batch.meshes = sources.size();
+
+  glGenVertexArrays(1, &batch.VAO);
+  glGenBuffers(1, &batch.VBO);
+  glGenBuffers(1, &batch.EBO);
+  glGenBuffers(1, &batch.commandBuffer);
+  glGenBuffers(1, &batch.drawBuffer);
+  glBindVertexArray(batch.VAO);
+
+  glBindBuffer(GL_ARRAY_BUFFER, batch.VBO);
+  glBufferData(GL_ARRAY_BUFFER, vertexBytes, nullptr, GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.EBO);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexTotal * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+  std::vector<unsigned int> sequential;
+  for(const Source& src : sources){
+    Mesh& mesh = *src.mesh;
+    glBindBuffer(GL_COPY_READ_BUFFER, mesh.VBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, 0, GLintptr(mesh.batchVertex) * vertexStride(batch.format), src.vertexBytes);
+    if(mesh.EBO){
+      glBindBuffer(GL_COPY_READ_BUFFER, mesh.EBO);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ELEMENT_ARRAY_BUFFER, 0, GLintptr(mesh.batchIndex) * sizeof(unsigned int), GLsizeiptr(src.indices) * sizeof(unsigned int));
+    }
+    else{
+      sequential.resize(src.indices);
+      for(GLint i=0; i<src.indices; i++) sequential[i] = i;
+      glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, GLintptr(mesh.batchIndex) * sizeof(unsigned int), GLsizeiptr(src.indices) * sizeof(unsigned int), sequential.data());
+    }
+    //copies are ordered before deletes, GL frees sources once they are done
+    glDeleteVertexArrays(1, &mesh.VAO);
+    glDeleteBuffers(1, &mesh.VBO);
+    if(mesh.EBO) glDeleteBuffers(1, &mesh.EBO);
+    mesh.VAO = mesh.VBO = mesh.EBO = 0;
+  }
+  setVertexAttributes(batch.format);
+  glBindVertexArray(0);
+
+  //diffuse maps of equal size and format become layers of one texture array, so texture
+  //changes don't split multi draws. Whole mip chains are copied on GPU, shared textures stay
+  //in TextureCache for RenderObject. Textures without storage remain bound one by one.
+  std::map<std::array<GLint, 3>, std::vector<GLuint>> sizes; //(width, height, format) -> textures
+  std::map<GLuint, std::pair<GLuint, GLint>> layers; //texture -> (array, layer)
+  for(const Source& src : sources){
+    GLuint texture = src.mesh->textureID;
+    if(!texture || !layers.emplace(texture, std::make_pair(0u, -1)).second) continue;
+    std::array<GLint, 3> key{};
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &key[0]);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &key[1]);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &key[2]);
+    //uploadTexture passes unsized formats, glTexStorage3D needs sized ones
+    switch(key[2]){
+      case GL_RED: key[2] = GL_R8; break;
+      case GL_RG: key[2] = GL_RG8; break;
+      case GL_RGB: key[2] = GL_RGB8; break;
+      case GL_RGBA: key[2] = GL_RGBA8; break;
+    }
+    if(key[0] > 0 && key[1] > 0) sizes[key].push_back(texture);
+  }
+  GLint maxLayers = 0;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+  maxLayers = std::max(maxLayers, 1);
+  for(const auto& [key, textures] : sizes){
+    GLsizei levels = std::bit_width(static_cast<unsigned int>(std::max(key[0], key[1])));
+    for(size_t first=0; first<textures.size(); first+=maxLayers){
+      GLsizei count = static_cast<GLsizei>(std::min<size_t>(maxLayers, textures.size() - first));
+      GLuint array;
+      glGenTextures(1, &array);
+      glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+      glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, key[2], key[0], key[1], count);
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      for(GLsizei layer=0; layer<count; layer++){
+        GLuint texture = textures[first + layer];
+        for(GLsizei level=0; level<levels; level++)
+          glCopyImageSubData(texture, GL_TEXTURE_2D, level, 0, 0, 0, array, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+                             std::max(key[0] >> level, 1), std::max(key[1] >> level, 1), 1);
+        layers[texture] = {array, layer};
+      }
+      batch.textures.push_back(array);
+    }
+  }
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  for(const Source& src : sources){
+    src.mesh->batchTexture = 0;
+    src.mesh->batchLayer = -1;
+    auto it = layers.find(src.mesh->textureID);
+    if(it != layers.end() && it->second.first){
+      src.mesh->batchTexture = it->second.first;
+      src.mesh->batchLayer = it->second.second;
+    }
+  }
+  return batch;
+}
+
+//draws meshes of list (collected and sorted as for submitDraws). Draw commands and per
+//draw data (GpuDraw) of meshes in batch are uploaded once per frame, then every run of
+//draws sharing texture array and pass goes out in one glMultiDrawElementsIndirect, meshes
+//without texture join any run. Whole mesh or its LOD level is one command, meshlets are not
+//culled. Meshes left out of batch go through submitDraws with meshShader and SetMesh,
+//between opaque and transparent calls. SetBatch holds locations of vs_mdi.glsl drawOffset
+//and fs.glsl diffuseM and diffuseArray.
+void submitBatch(SceneBatch& batch, const DrawList& list, Shader& shader, GLint* SetBatch, Shader& meshShader, GLint* SetMesh, const View* view = nullptr){
+  std::vector<SceneBatch::Call>& calls = batch.calls;
+  calls.clear();
+  batch.commands.clear();
+  batch.draws.clear();
+  batch.unbatched.clear();
+  for(uint32_t index : list.order){
+    const Mesh& mesh = *list.meshes[index];
+    if(mesh.batchVertex < 0){
+      batch.unbatched.order.push_back(static_cast<uint32_t>(batch.unbatched.meshes.size()));
+      batch.unbatched.keys.push_back(list.keys[index]);
+      batch.unbatched.meshes.push_back(list.meshes[index]);
+      continue;
+    }
+    DrawElementsIndirectCommand cmd{static_cast<GLuint>(mesh.indexCount), 1, mesh.batchIndex, mesh.batchVertex, 0};
+    if(mesh.lod > 0){
+      const LodRange& range = mesh.lods[mesh.lod - 1];
+      cmd.count = range.indexCount;
+      cmd.firstIndex += range.indexOffset;
+    }
+    GpuDraw draw;
+    std::copy_n(&mesh.dequantize[0][0], 16, draw.dequantize);
+    draw.materialId = mesh.materialId;
+    draw.state = mesh.state;
+    draw.octNormals = mesh.octNormals;
+    draw.layer = mesh.batchLayer;
+    //texture or array mesh samples, unbound when it doesn't sample any
+    GLuint texture = SceneBatch::Call::unbound, array = SceneBatch::Call::unbound;
+    if(mesh.state & 1){
+      if(mesh.batchTexture) array = mesh.batchTexture;
+      else texture = mesh.textureID;
+    }
+    auto fits = [](GLuint bound, GLuint wanted){ return wanted == SceneBatch::Call::unbound || bound == SceneBatch::Call::unbound || bound == wanted; };
+    if(calls.empty() || calls.back().transparent != mesh.transparent || !fits(calls.back().texture, texture) || !fits(calls.back().array, array))
+      calls.push_back({batch.commands.size(), 0, SceneBatch::Call::unbound, SceneBatch::Call::unbound, mesh.transparent});
+    SceneBatch::Call& call = calls.back();
+    if(texture != SceneBatch::Call::unbound) call.texture = texture;
+    if(array != SceneBatch::Call::unbound) call.array = array;
+    call.count++;
+    batch.commands.push_back(cmd);
+    batch.draws.push_back(draw);
+    if(view && view->stats){
+      view->stats->triangles[std::min(mesh.lod, FrameStats::maxLevels - 1)] += cmd.count / 3;
+      view->stats->draws++;
+    }
+  }
+  if(batch.commands.empty()){
+    submitDraws(batch.unbatched, meshShader, SetMesh, view);
+    return;
+  }
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch.commandBuffer);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER, batch.commands.size() * sizeof(DrawElementsIndirectCommand), batch.commands.data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, batch.drawBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, batch.draws.size() * sizeof(GpuDraw), batch.draws.data(), GL_STREAM_DRAW);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SceneBatch::drawBinding, batch.drawBuffer);
+
+  auto bindBatch = [&](){
+    glUseProgram(shader.ID);
+    glUniform1i(SetBatch[1], 0);
+    glUniform1i(SetBatch[2], 1);
+    glBindVertexArray(batch.VAO);
+  };
+  bindBatch();
+  bool blending = false, unbatchedDrawn = batch.unbatched.order.empty();
+  for(const SceneBatch::Call& call : calls){
+    //opaque meshes outside batch have to be in depth buffer before blending starts
+    if(call.transparent && !unbatchedDrawn){
+      glBindVertexArray(0);
+      submitDraws(batch.unbatched, meshShader, SetMesh, view);
+      unbatchedDrawn = true;
+      bindBatch();
+    }
+    if(call.transparent != blending){
+      blending = call.transparent;
+      if(blending){
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE);
+      }
+      else{
+        glDisable(GL_BLEND);
+        glDepthMask(GL_TRUE);
+      }
+    }
+    if(call.texture != SceneBatch::Call::unbound){
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, call.texture);
+    }
+    if(call.array != SceneBatch::Call::unbound){
+      glActiveTexture(GL_TEXTURE1);
+      glBindTexture(GL_TEXTURE_2D_ARRAY, call.array);
+    }
+    glUniform1i(SetBatch[0], static_cast<GLint>(call.first));
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(call.first * sizeof(DrawElementsIndirectCommand)), static_cast<GLsizei>(call.count), 0);
+  }
+  glBindVertexArray(0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  glActiveTexture(GL_TEXTURE0); //submitDraws binds diffuse maps to current unit
+  if(blending){
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+  }
+  if(view && view->stats){
+    view->stats->drawCalls += calls.size();
+    view->stats->multiDrawCalls += calls.size();
+  }
+  if(!unbatchedDrawn) submitDraws(batch.unbatched, meshShader, SetMesh, view);
+}
+
+//frees shared buffers and texture arrays and with them geometry of meshes that were in
+//batch, models still have to be released with DestroyModel
+void DestroySceneBatch(SceneBatch& batch, std::vector<Model>& models){
+  for(Model& model : models)
+    for(Mesh& mesh : model.meshes){
+      mesh.batchVertex = -1;
+      mesh.batchTexture = 0;
+      mesh.batchLayer = -1;
+    }
+  if(!batch.textures.empty()) glDeleteTextures(static_cast<GLsizei>(batch.textures.size()), batch.textures.data());
+  glDeleteVertexArrays(1, &batch.VAO);
+  GLuint buffers[] = {batch.VBO, batch.EBO, batch.commandBuffer, batch.drawBuffer};
+  glDeleteBuffers(4, buffers);
+  batch = SceneBatch();
+}
+
 void DestroyModel(Model& model) {
   for (auto& mesh : model.meshes) {
     glDeleteVertexArrays(1, &mesh.VAO);
     glDeleteBuffers(1, &mesh.VBO);
+    if(mesh.EBO) glDeleteBuffers(1, &mesh.EBO);
   }
   model.meshes.clear();
 }
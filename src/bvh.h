@@ -0,0 +1,625 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "objLoader.h"
+#include "meshOptimizer.h"
+#include "glm/glm.hpp"
+
+namespace bvh {
+
+//32 bytes, children of inner node are stored next to each other
+struct Node{
+  float min[3];
+  uint32_t leftFirst; //inner - index of left child, leaf - first triangle
+  float max[3];
+  uint32_t count; //triangles in leaf, 0 - inner node
+};
+static_assert(sizeof(Node) == 32, "Node should fill half a cache line");
+
+//triangle stored for Moller-Trumbore test
+struct Triangle{
+  float v0[3], e1[3], e2[3];
+};
+
+//where triangle came from: Objects[object].meshes[mesh], corners 3 * triangle
+struct TriangleId{
+  uint32_t object, mesh, triangle;
+};
+
+struct Ray{
+  glm::vec3 origin;
+  glm::vec3 direction;
+  float tMax = FLT_MAX;
+};
+
+struct Hit{
+  float t = FLT_MAX;
+  float u = 0.0f, v = 0.0f; //barycentrics of corners 1 and 2
+  uint32_t triangle = ~0u; //index into Bvh::triangles and Bvh::ids
+
+  bool hit() const{ return triangle != ~0u; }
+};
+
+struct Bvh{
+  std::vector<Node> nodes; //root at 0
+  std::vector<Triangle> triangles; //in leaf order
+  std::vector<TriangleId> ids;
+};
+
+struct BuildOptions{
+  unsigned int threads = 0; //0 - one per core
+  unsigned int bins = 16; //SAH candidates per axis
+  unsigned int maxLeafSize = 4;
+};
+
+//------------------ build
+
+struct alignas(16) PrimBounds{
+  float min[4], max[4]; //4th lane unused, keeps min/max 4 wide
+};
+
+struct alignas(16) Bounds{
+  float min[4] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX}, max[4] = {-FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+  void grow(const float* lo, const float* hi){
+#ifdef MESHOPTIMIZER_SSE2
+    _mm_store_ps(min, _mm_min_ps(_mm_load_ps(min), _mm_load_ps(lo)));
+    _mm_store_ps(max, _mm_max_ps(_mm_load_ps(max), _mm_load_ps(hi)));
+#else
+    for(int k=0; k<4; k++){
+      min[k] = std::min(min[k], lo[k]);
+      max[k] = std::max(max[k], hi[k]);
+    }
+#endif
+  }
+  void grow(const Bounds& b){ grow(b.min, b.max); }
+  void grow(const PrimBounds& b){ grow(b.min, b.max); }
+  float area() const{
+    float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+    return dx < 0.0f ? 0.0f : dx * dy + dy * dz + dz * dx;
+  }
+};
+
+struct Bin{
+  Bounds box;
+  uint32_t count = 0;
+};
+
+//binned SAH (Wald 2007). Children get box bounds from bins and centroid bounds from
+//the partition pass, so every level reads each primitive twice. Ranges bigger than
+//parallelSize are binned and partitioned with all threads one at a time, the rest
+//are built as independent subtrees in parallel.
+struct Builder{
+  static constexpr unsigned int maxBins = 64;
+  static constexpr unsigned int maxDepth = 100; //traversal stack holds one entry per level
+  static constexpr size_t chunk = 1 << 16; //primitives per parallel work item
+
+  typedef std::array<std::array<Bin, maxBins>, 3> BinGrid; //per axis
+
+  //centroids are doubled (min + max), same scale as bounds
+  struct Task{
+    uint32_t node, begin, end, depth;
+    Bounds box, centroids;
+
+    uint32_t count() const{ return end - begin; }
+  };
+
+  struct Split{
+    int axis = -1;
+    uint32_t bin = 0;
+    float cost = FLT_MAX;
+    Bounds left, right;
+  };
+
+  //maps doubled centroid to bin along every axis
+  struct Binning{
+    float offset[3], scale[3];
+    unsigned int last;
+
+    Binning(const Bounds& centroids, unsigned int bins) : last(bins - 1){
+      for(int k=0; k<3; k++){
+        float extent = centroids.max[k] - centroids.min[k];
+        offset[k] = centroids.min[k];
+        scale[k] = extent > 0.0f ? bins / extent * 0.9999f : 0.0f;
+      }
+    }
+    unsigned int bin(const float* c, int axis) const{
+      return std::min(last, static_cast<unsigned int>((c[axis] - offset[axis]) * scale[axis]));
+    }
+  };
+
+  const std::vector<PrimBounds>& bounds;
+  std::vector<uint32_t>& refs;
+  std::vector<uint32_t> scratch;
+  BuildOptions options;
+  unsigned int threads;
+
+  Builder(const std::vector<PrimBounds>& bounds, std::vector<uint32_t>& refs, const BuildOptions& options) : bounds(bounds), refs(refs), options(options){
+    this->options.bins = std::clamp(options.bins, 2u, maxBins);
+    this->options.maxLeafSize = std::max(options.maxLeafSize, 1u);
+    threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  static void centroid(const PrimBounds& b, float* c){
+    for(int k=0; k<4; k++) c[k] = b.min[k] + b.max[k];
+  }
+
+  void measure(uint32_t begin, uint32_t end, Bounds& box, Bounds& centroids) const{
+    alignas(16) float c[4];
+    for(uint32_t i=begin; i<end; i++){
+      const PrimBounds& b = bounds[refs[i]];
+      centroid(b, c);
+      box.grow(b);
+      centroids.grow(c, c);
+    }
+  }
+
+  //small ranges get fewer bins, resetting and sweeping them would cost more than binning
+  unsigned int binCount(uint32_t count) const{
+    return std::clamp(count / 2, 2u, options.bins);
+  }
+
+  void binRange(uint32_t begin, uint32_t end, const Binning& binning, BinGrid& bins) const{
+    alignas(16) float c[4];
+    for(uint32_t i=begin; i<end; i++){
+      const PrimBounds& b = bounds[refs[i]];
+      centroid(b, c);
+      for(int k=0; k<3; k++){
+        Bin& bin = bins[k][binning.bin(c, k)];
+        bin.box.grow(b);
+        bin.count++;
+      }
+    }
+  }
+
+  Split bestSplit(const BinGrid& bins, const Bounds& centroids, unsigned int n) const{
+    Split best;
+    for(int k=0; k<3; k++){
+      if(centroids.max[k] <= centroids.min[k]) continue;
+      float rightCost[maxBins];
+      Bounds right;
+      uint32_t rightCount = 0;
+      for(unsigned int i=n - 1; i>0; i--){
+        right.grow(bins[k][i].box);
+        rightCount += bins[k][i].count;
+        rightCost[i] = right.area() * rightCount;
+      }
+      Bounds left;
+      uint32_t leftCount = 0;
+      for(unsigned int i=0; i<n - 1; i++){
+        left.grow(bins[k][i].box);
+        leftCount += bins[k][i].count;
+        float cost = left.area() * leftCount + rightCost[i + 1];
+        if(cost < best.cost){
+          best.cost = cost;
+          best.axis = k;
+          best.bin = i + 1;
+        }
+      }
+    }
+    if(best.axis >= 0)
+      for(unsigned int i=0; i<n; i++)
+        (i < best.bin ? best.left : best.right).grow(bins[best.axis][i].box);
+    return best;
+  }
+
+  static void setBounds(Node& node, const Bounds& box){
+    std::copy_n(box.min, 3, node.min);
+    std::copy_n(box.max, 3, node.max);
+  }
+
+  //in place partition that also collects centroid bounds of both sides
+  uint32_t partitionSerial(uint32_t begin, uint32_t end, const Split& s, const Binning& binning, Bounds& leftC, Bounds& rightC){
+    alignas(16) float c[4];
+    uint32_t i = begin, j = end;
+    while(i < j){
+      centroid(bounds[refs[i]], c);
+      if(binning.bin(c, s.axis) < s.bin){
+        leftC.grow(c, c);
+        i++;
+      }
+      else{
+        rightC.grow(c, c);
+        std::swap(refs[i], refs[--j]);
+      }
+    }
+    return i;
+  }
+
+  //stable partition through scratch, chunks are counted and scattered in parallel
+  uint32_t partitionParallel(uint32_t begin, uint32_t end, const Split& s, const Binning& binning, Bounds& leftC, Bounds& rightC){
+    size_t chunks = (end - begin + chunk - 1) / chunk;
+    std::vector<uint32_t> lefts(chunks, 0);
+    auto goesLeft = [&](uint32_t ref, float* c){
+      centroid(bounds[ref], c);
+      return binning.bin(c, s.axis) < s.bin;
+    };
+    meshOptimizer::parallelFor(chunks, threads, [&](size_t c){
+      alignas(16) float p[4];
+      uint32_t first = begin + static_cast<uint32_t>(c * chunk), last = std::min<uint32_t>(end, first + chunk);
+      for(uint32_t i=first; i<last; i++) lefts[c] += goesLeft(refs[i], p);
+    });
+    std::vector<uint32_t> leftAt(chunks), rightAt(chunks);
+    uint32_t totalLeft = 0;
+    for(uint32_t l : lefts) totalLeft += l;
+    uint32_t l = begin, r = begin + totalLeft;
+    for(size_t c=0; c<chunks; c++){
+      uint32_t size = std::min<uint32_t>(end - begin - static_cast<uint32_t>(c * chunk), chunk);
+      leftAt[c] = l;
+      rightAt[c] = r;
+      l += lefts[c];
+      r += size - lefts[c];
+    }
+    std::vector<Bounds> leftBounds(chunks), rightBounds(chunks);
+    meshOptimizer::parallelFor(chunks, threads, [&](size_t c){
+      alignas(16) float p[4];
+      uint32_t first = begin + static_cast<uint32_t>(c * chunk), last = std::min<uint32_t>(end, first + chunk);
+      uint32_t li = leftAt[c], ri = rightAt[c];
+      for(uint32_t i=first; i<last; i++){
+        if(goesLeft(refs[i], p)){
+          leftBounds[c].grow(p, p);
+          scratch[li++] = refs[i];
+        }
+        else{
+          rightBounds[c].grow(p, p);
+          scratch[ri++] = refs[i];
+        }
+      }
+    });
+    meshOptimizer::parallelFor(chunks, threads, [&](size_t c){
+      uint32_t first = begin + static_cast<uint32_t>(c * chunk), last = std::min<uint32_t>(end, first + chunk);
+      std::copy(scratch.begin() + first, scratch.begin() + last, refs.begin() + first);
+    });
+    for(size_t c=0; c<chunks; c++){
+      leftC.grow(leftBounds[c]);
+      rightC.grow(rightBounds[c]);
+    }
+    return begin + totalLeft;
+  }
+
+  //leaf when SAH says so (traversal step costs as much as one triangle test),
+  //otherwise partitions range and fills both children
+  bool split(const Task& t, const BinGrid& bins, const Binning& binning, bool parallel, Task& left, Task& right){
+    uint32_t count = t.count();
+    if(count <= 1 || t.depth >= maxDepth) return false;
+    Split s = bestSplit(bins, t.centroids, binning.last + 1);
+    if(count <= options.maxLeafSize && (s.axis < 0 || t.box.area() * count <= s.cost + t.box.area())) return false;
+
+    left = {0, t.begin, t.begin, t.depth + 1, s.left, Bounds()};
+    right = {0, t.begin, t.end, t.depth + 1, s.right, Bounds()};
+    uint32_t mid = t.begin;
+    if(s.axis >= 0)
+      mid = parallel ? partitionParallel(t.begin, t.end, s, binning, left.centroids, right.centroids)
+                     : partitionSerial(t.begin, t.end, s, binning, left.centroids, right.centroids);
+    if(mid == t.begin || mid == t.end){
+      //centroids coincide, halves of the list are as good as any split
+      mid = t.begin + count / 2;
+      left = {0, t.begin, mid, t.depth + 1, Bounds(), Bounds()};
+      right = {0, mid, t.end, t.depth + 1, Bounds(), Bounds()};
+      measure(left.begin, left.end, left.box, left.centroids);
+      measure(right.begin, right.end, right.box, right.centroids);
+    }
+    left.end = right.begin = mid;
+    return true;
+  }
+
+  //children of node go to the end of nodes, pushed so left one is processed first
+  static void addChildren(std::vector<Node>& nodes, uint32_t node, Task& left, Task& right, std::vector<Task>& stack){
+    left.node = static_cast<uint32_t>(nodes.size());
+    right.node = left.node + 1;
+    nodes.resize(nodes.size() + 2);
+    nodes[node].leftFirst = left.node;
+    nodes[node].count = 0;
+    stack.push_back(right);
+    stack.push_back(left);
+  }
+
+  static void makeLeaf(Node& node, const Task& t){
+    node.leftFirst = t.begin;
+    node.count = t.count();
+  }
+
+  //builds subtree of task into nodes, task.node is already allocated there
+  void buildSerial(std::vector<Node>& nodes, const Task& root){
+    std::vector<Task> stack{root};
+    BinGrid bins;
+    while(!stack.empty()){
+      Task t = stack.back();
+      stack.pop_back();
+      setBounds(nodes[t.node], t.box);
+      if(t.count() == 1){
+        makeLeaf(nodes[t.node], t);
+        continue;
+      }
+      Binning binning(t.centroids, binCount(t.count()));
+      for(auto& axis : bins)
+        std::fill(axis.begin(), axis.begin() + binning.last + 1, Bin());
+      binRange(t.begin, t.end, binning, bins);
+      Task left, right;
+      if(split(t, bins, binning, false, left, right))
+        addChildren(nodes, t.node, left, right, stack);
+      else
+        makeLeaf(nodes[t.node], t);
+    }
+  }
+
+  std::vector<Node> build(){
+    uint32_t total = static_cast<uint32_t>(refs.size());
+    std::vector<Node> nodes(1);
+    nodes[0] = Node{{0, 0, 0}, 0, {0, 0, 0}, 0};
+    if(total == 0) return nodes;
+    size_t parallelSize = std::max<size_t>(chunk * 2, total / (size_t(threads) * 8));
+    if(threads <= 1) parallelSize = ~size_t(0);
+    else scratch.resize(total);
+
+    size_t chunks = (total + chunk - 1) / chunk;
+    std::vector<Bounds> boxes(chunks), centroids(chunks);
+    meshOptimizer::parallelFor(chunks, threads, [&](size_t c){
+      measure(static_cast<uint32_t>(c * chunk), std::min<uint32_t>(total, static_cast<uint32_t>((c + 1) * chunk)), boxes[c], centroids[c]);
+    });
+    Task root{0, 0, total, 0, Bounds(), Bounds()};
+    for(size_t c=0; c<chunks; c++){
+      root.box.grow(boxes[c]);
+      root.centroids.grow(centroids[c]);
+    }
+
+    //top levels: one big range at a time, binned and partitioned with all threads
+    std::vector<Task> pending{root}, subtrees;
+    while(!pending.empty()){
+      Task t = pending.back();
+      pending.pop_back();
+      if(t.count() <= parallelSize){
+        subtrees.push_back(t);
+        continue;
+      }
+      setBounds(nodes[t.node], t.box);
+      Binning binning(t.centroids, binCount(t.count()));
+      size_t tChunks = (t.count() + chunk - 1) / chunk;
+      std::vector<BinGrid> partial(tChunks);
+      meshOptimizer::parallelFor(tChunks, threads, [&](size_t c){
+        uint32_t first = t.begin + static_cast<uint32_t>(c * chunk);
+        binRange(first, std::min<uint32_t>(t.end, first + chunk), binning, partial[c]);
+      });
+      BinGrid bins;
+      for(const BinGrid& p : partial)
+        for(int k=0; k<3; k++)
+          for(unsigned int i=0; i<=binning.last; i++){
+            bins[k][i].box.grow(p[k][i].box);
+            bins[k][i].count += p[k][i].count;
+          }
+
+      Task left, right;
+      if(split(t, bins, binning, true, left, right))
+        addChildren(nodes, t.node, left, right, pending);
+      else
+        makeLeaf(nodes[t.node], t);
+    }
+
+    //subtrees build into own arrays, their root goes to slot reserved above
+    std::vector<std::vector<Node>> local(subtrees.size());
+    meshOptimizer::parallelFor(subtrees.size(), threads, [&](size_t i){
+      local[i].resize(1);
+      local[i].reserve(size_t(subtrees[i].count()) * 2);
+      Task t = subtrees[i];
+      t.node = 0;
+      buildSerial(local[i], t);
+    });
+    for(size_t i=0; i<subtrees.size(); i++){
+      uint32_t base = static_cast<uint32_t>(nodes.size()) - 1; //local index 1 lands on nodes.size()
+      for(Node& n : local[i])
+        if(n.count == 0) n.leftFirst += base;
+      nodes[subtrees[i].node] = local[i][0];
+      nodes.insert(nodes.end(), local[i].begin() + 1, local[i].end());
+    }
+    return nodes;
+  }
+};
+
+//bvh over triangles of every mesh in objects. Corners pointing outside of vertices
+//give degenerate triangles that are never hit, so ids still match mesh triangles.
+Bvh build(std::span<const objLoader::Object> objects, const BuildOptions& options = BuildOptions()){
+  Bvh bvh;
+  struct Source{
+    uint32_t object, mesh;
+    size_t first;
+  };
+  std::vector<Source> sources;
+  size_t total = 0;
+  for(size_t o=0; o<objects.size(); o++)
+    for(size_t m=0; m<objects[o].meshes.size(); m++){
+      sources.push_back({static_cast<uint32_t>(o), static_cast<uint32_t>(m), total});
+      total += objects[o].meshes[m].positions.size() / 3;
+    }
+
+  std::vector<PrimBounds> bounds(total);
+  std::vector<Triangle> triangles(total);
+  std::vector<TriangleId> ids(total);
+  meshOptimizer::parallelFor(sources.size(), options.threads, [&](size_t s){
+    const objLoader::Object& object = objects[sources[s].object];
+    const objLoader::Mesh& mesh = object.meshes[sources[s].mesh];
+    size_t vCount = object.vertices.size() / 3;
+    for(size_t t=0; t<mesh.positions.size() / 3; t++){
+      size_t at = sources[s].first + t;
+      ids[at] = {sources[s].object, sources[s].mesh, static_cast<uint32_t>(t)};
+      glm::vec3 p[3];
+      bool valid = true;
+      for(int k=0; k<3; k++){
+        unsigned int v = mesh.positions[t * 3 + k];
+        valid = valid && v < vCount;
+        if(valid) p[k] = glm::vec3(object.vertices[v * 3], object.vertices[v * 3 + 1], object.vertices[v * 3 + 2]);
+      }
+      if(!valid) p[0] = p[1] = p[2] = glm::vec3(0.0f);
+      glm::vec3 lo = glm::min(p[0], glm::min(p[1], p[2])), hi = glm::max(p[0], glm::max(p[1], p[2]));
+      glm::vec3 e1 = p[1] - p[0], e2 = p[2] - p[0];
+      bounds[at] = {{lo.x, lo.y, lo.z, 0.0f}, {hi.x, hi.y, hi.z, 0.0f}};
+      triangles[at] = {{p[0].x, p[0].y, p[0].z}, {e1.x, e1.y, e1.z}, {e2.x, e2.y, e2.z}};
+    }
+  });
+
+  std::vector<uint32_t> refs(total);
+  for(size_t i=0; i<total; i++) refs[i] = static_cast<uint32_t>(i);
+  Builder builder(bounds, refs, options);
+  bvh.nodes = builder.build();
+
+  //triangles in leaf order, leaves read them sequentially
+  bvh.triangles.resize(total);
+  bvh.ids.resize(total);
+  size_t chunks = (total + Builder::chunk - 1) / Builder::chunk;
+  meshOptimizer::parallelFor(chunks, options.threads, [&](size_t c){
+    size_t last = std::min(total, (c + 1) * Builder::chunk);
+    for(size_t i=c * Builder::chunk; i<last; i++){
+      bvh.triangles[i] = triangles[refs[i]];
+      bvh.ids[i] = ids[refs[i]];
+    }
+  });
+  return bvh;
+}
+
+Bvh build(const objLoader::Object& object, const BuildOptions& options = BuildOptions()){
+  return build(std::span<const objLoader::Object>(&object, 1), options);
+}
+
+//------------------ traversal
+
+//ray with reciprocal direction, zero components are nudged so slab test has no 0 * inf
+struct RayData{
+  float origin[4], invDir[4];
+  glm::vec3 o, d;
+
+  explicit RayData(const Ray& ray) : o(ray.origin), d(ray.direction){
+    for(int k=0; k<3; k++){
+      float dk = std::abs(d[k]) < 1e-20f ? std::copysign(1e-20f, d[k]) : d[k];
+      origin[k] = o[k];
+      invDir[k] = 1.0f / dk;
+    }
+    origin[3] = invDir[3] = 0.0f;
+  }
+};
+
+//entry distance of ray into node box, FLT_MAX when missed or farther than tMax
+inline float intersectNode(const Node& n, const RayData& r, float tMax){
+#ifdef MESHOPTIMIZER_SSE2
+  #ifdef MESHOPTIMIZER_GLM_SHIM
+  using meshOptimizer::glm_vec4;
+  using meshOptimizer::glm_vec4_sub;
+  using meshOptimizer::glm_vec4_mul;
+  #endif
+  const glm_vec4 o = _mm_loadu_ps(r.origin), inv = _mm_loadu_ps(r.invDir);
+  glm_vec4 t1 = glm_vec4_mul(glm_vec4_sub(_mm_loadu_ps(n.min), o), inv);
+  glm_vec4 t2 = glm_vec4_mul(glm_vec4_sub(_mm_loadu_ps(n.max), o), inv);
+  //4th lane holds node index bits, it is replaced by ray interval [0, tMax]
+  const glm_vec4 xyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+  glm_vec4 lo = _mm_and_ps(_mm_min_ps(t1, t2), xyz);
+  glm_vec4 hi = _mm_or_ps(_mm_and_ps(_mm_max_ps(t1, t2), xyz), _mm_andnot_ps(xyz, _mm_set1_ps(tMax)));
+  lo = _mm_max_ps(lo, _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(1, 0, 3, 2)));
+  lo = _mm_max_ps(lo, _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(2, 3, 0, 1)));
+  hi = _mm_min_ps(hi, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(1, 0, 3, 2)));
+  hi = _mm_min_ps(hi, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(2, 3, 0, 1)));
+  float tNear = _mm_cvtss_f32(lo), tFar = _mm_cvtss_f32(hi);
+#else
+  float tNear = 0.0f, tFar = tMax;
+  for(int k=0; k<3; k++){
+    float t1 = (n.min[k] - r.origin[k]) * r.invDir[k], t2 = (n.max[k] - r.origin[k]) * r.invDir[k];
+    tNear = std::max(tNear, std::min(t1, t2));
+    tFar = std::min(tFar, std::max(t1, t2));
+  }
+#endif
+  return tNear <= tFar ? tNear : FLT_MAX;
+}
+
+//Moller-Trumbore, both sides count
+inline bool intersectTriangle(const Triangle& tri, const RayData& r, float tMax, Hit& hit){
+  glm::vec3 e1(tri.e1[0], tri.e1[1], tri.e1[2]), e2(tri.e2[0], tri.e2[1], tri.e2[2]);
+  glm::vec3 p = glm::cross(r.d, e2);
+  float det = glm::dot(e1, p);
+  if(std::abs(det) < 1e-12f) return false;
+  float inv = 1.0f / det;
+  glm::vec3 s = r.o - glm::vec3(tri.v0[0], tri.v0[1], tri.v0[2]);
+  float u = glm::dot(s, p) * inv;
+  if(u < 0.0f || u > 1.0f) return false;
+  glm::vec3 q = glm::cross(s, e1);
+  float v = glm::dot(r.d, q) * inv;
+  if(v < 0.0f || u + v > 1.0f) return false;
+  float t = glm::dot(e2, q) * inv;
+  if(t < 0.0f || t >= tMax) return false;
+  hit.t = t;
+  hit.u = u;
+  hit.v = v;
+  return true;
+}
+
+//near child first, stack holds one far child per level with its entry distance
+template<bool anyHit>
+Hit traverse(const Bvh& bvh, const Ray& ray){
+  Hit hit;
+  hit.t = ray.tMax;
+  if(bvh.triangles.empty()) return hit;
+  RayData r(ray);
+  uint32_t stack[Builder::maxDepth + 2];
+  float entry[Builder::maxDepth + 2];
+  unsigned int size = 0;
+  if(intersectNode(bvh.nodes[0], r, hit.t) == FLT_MAX) return hit;
+  uint32_t node = 0;
+  while(true){
+    const Node& n = bvh.nodes[node];
+    if(n.count){
+      for(uint32_t i=n.leftFirst; i<n.leftFirst + n.count; i++)
+        if(intersectTriangle(bvh.triangles[i], r, hit.t, hit)){
+          hit.triangle = i;
+          if(anyHit) return hit;
+        }
+    }
+    else{
+      uint32_t a = n.leftFirst, b = n.leftFirst + 1;
+      float da = intersectNode(bvh.nodes[a], r, hit.t), db = intersectNode(bvh.nodes[b], r, hit.t);
+      if(db < da){
+        std::swap(a, b);
+        std::swap(da, db);
+      }
+      if(da != FLT_MAX){
+        if(db != FLT_MAX){
+          stack[size] = b;
+          entry[size++] = db;
+        }
+        node = a;
+        continue;
+      }
+    }
+    //skip far children that start behind closest hit found since they were pushed
+    while(size > 0 && entry[size - 1] >= hit.t) size--;
+    if(size == 0) break;
+    node = stack[--size];
+  }
+  return hit;
+}
+
+//closest triangle along ray within ray.tMax
+Hit closestHit(const Bvh& bvh, const Ray& ray){
+  return traverse<false>(bvh, ray);
+}
+
+//true if anything blocks ray before ray.tMax, for line of sight tests
+bool anyHit(const Bvh& bvh, const Ray& ray){
+  return traverse<true>(bvh, ray).hit();
+}
+
+//ray through pixel (x, y) from top left of viewport, for mouse picking
+Ray screenRay(float x, float y, float width, float height, const glm::mat4& projection, const glm::mat4& view){
+  glm::mat4 inv = glm::inverse(projection * view);
+  float nx = 2.0f * x / width - 1.0f, ny = 1.0f - 2.0f * y / height;
+  glm::vec4 nearPoint = inv * glm::vec4(nx, ny, -1.0f, 1.0f), farPoint = inv * glm::vec4(nx, ny, 1.0f, 1.0f);
+  Ray ray;
+  ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+  ray.direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - ray.origin);
+  return ray;
+}
+
+}//close namespace
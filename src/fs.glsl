@@ -16,12 +16,23 @@ out vec4 FragColor;
  */
 struct Material {
   vec3 ambient;
-  sampler2D diffuseM;
   vec3 diffuse;
   vec3 specular;
   float shininess;
 };
 
+//Renderer::GpuMaterial, ambient.w - shininess, diffuse.w - opacity
+struct MaterialData {
+  vec4 ambient;
+  vec4 diffuse;
+  vec4 specular;
+};
+
+#define MAX_MATERIALS 256
+layout(std140) uniform MaterialBlock {
+  MaterialData materials[MAX_MATERIALS];
+};
+
 struct Light {
   vec3 ambient;
   vec3 diffuse;
@@ -38,31 +49,41 @@ uniform Position Lights[50];
 in vec3 Normal;  
 in vec3 FragPos;  
 in vec2 TexCoords;
+flat in int MaterialId; //set per mesh by vs.glsl, per draw by vs_mdi.glsl
+flat in int State; //0 - vertices  1 - vertices and texture  2 - vertices and normals  3 - all
+flat in int Layer; //layer of diffuse map in diffuseArray, -1 - diffuseM
 
-uniform Material material;
+uniform sampler2D diffuseM;
+uniform sampler2DArray diffuseArray; //texture unit 1, diffuseM stays on 0
 uniform Light light;
-uniform int state; //0 - vertices  1 - vertices and texture  2 - vertices and normals  3 - all
 
 uniform vec3 viewPos;
 
+vec3 diffuseTexel(){
+  if(Layer >= 0) return vec3(texture(diffuseArray, vec3(TexCoords, Layer)));
+  return vec3(texture(diffuseM, TexCoords));
+}
+
 void main(){
+  MaterialData data = materials[MaterialId];
+  Material material = Material(data.ambient.xyz, data.diffuse.xyz, data.specular.xyz, data.ambient.w);
   vec3 result = vec3(0.0);
   float ambientStrength=0.3;
 
   //pure vertices
-  if(state == 0){ 
+  if(State == 0){ 
     vec3 ambient = ambientStrength * light.ambient * material.ambient;
 
     result = ambient;
   }
   //vertices + texture
-  else if(state == 1){ 
-    vec3 ambient = vec3(texture(material.diffuseM, TexCoords)) * ambientStrength * light.ambient * material.ambient; 
+  else if(State == 1){ 
+    vec3 ambient = diffuseTexel() * ambientStrength * light.ambient * material.ambient; 
 
     result = ambient;
   }
   //vertices + normals
-  else if(state == 2){ 
+  else if(State == 2){ 
     vec3 ambient = ambientStrength * light.ambient * material.ambient;
     vec3 norm = normalize(Normal);
     
@@ -88,8 +109,8 @@ void main(){
     }
   }
   //all 
-  else if(state == 3){ 
-    vec3 ambient = vec3(texture(material.diffuseM, TexCoords)) * ambientStrength * light.ambient * material.ambient;
+  else if(State == 3){ 
+    vec3 ambient = diffuseTexel() * ambientStrength * light.ambient * material.ambient;
     vec3 norm = normalize(Normal);
     float lightFactor = 2.0 / float(Nr_Lights);
     
@@ -101,7 +122,7 @@ void main(){
       
       vec3 lightDir = normalize(Lights[i].position - FragPos);
       float diff = max(dot(norm, lightDir), 0.0);
-      vec3 diffuse = diff * vec3(texture(material.diffuseM, TexCoords)) * material.diffuse * light.diffuse;
+      vec3 diffuse = diff * diffuseTexel() * material.diffuse * light.diffuse;
   
       vec3 viewDir = normalize(viewPos - FragPos);
       vec3 reflectDir = reflect(-lightDir, norm);  
@@ -114,5 +135,5 @@ void main(){
     }
   }
 
-  FragColor = vec4(result, 1.0);
+  FragColor = vec4(result, data.diffuse.w); //opacity, blended only for transparent draws
 }
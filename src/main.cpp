@@ -1,6 +1,7 @@
 #include <GL/glew.h>
 
 #include <GLFW/glfw3.h>
+#include <array>
 #include <complex>
 #include <cstring>
 #include <filesystem>
@@ -11,6 +12,7 @@
 #include "glm/detail/qualifier.hpp"
 #include "glm/ext/vector_float3.hpp"
 #include "objLoader.h"
+#include "scene.h"
 #include "shader.h"
 #include "camera.h"
 #include "glm/glm.hpp"
@@ -27,14 +29,14 @@ bool firstMouse = true;
 float deltaTime = 0.0f;	
 float lastFrame = 0.0f;
 
-void init(GLFWwindow*& window, bool flip);
+void init(GLFWwindow*& window, bool flip, bool& multiDraw);
 void terminate();
 void processInput(GLFWwindow *window);
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn);
 
 int main(int32_t _argc, char** _argv){
   if (_argc < 2) {
-    std::cout<<"Missing file path\nDo: ./objLoader <filepath> <texture flip (0|1)*> <number of lights*>\n";
+    std::cout<<"Missing file path\nDo: ./objLoader <filepath> <texture flip (0|1)*> <number of lights*> <lod pixel error*> <draw mode (mdi)*>\n";
 		return EXIT_FAILURE;
 	}
 	if (!std::filesystem::exists(_argv[1])) {
@@ -52,8 +54,12 @@ int main(int32_t _argc, char** _argv){
   if(_argc > 3) lights=std::stoi(_argv[3]);
 
   lights = (lights > 50) ? 50 : lights; 
+
+  float pixelError = 1.0f;
+  if(_argc > 4) pixelError = std::stof(_argv[4]);
+  bool multiDraw = _argc > 5 && std::strcmp(_argv[5], "mdi") == 0;
   GLFWwindow* window;
-  init(window, flip);
+  init(window, flip, multiDraw);
 
 
   std::vector<objLoader::Object> Objects;
@@ -61,24 +67,60 @@ int main(int32_t _argc, char** _argv){
   if (!objLoader::loadObject(Objects, Materials, path) ) {
     std::cout << "FAILED TO LOAD OBJ FILE\n";
   }
+  //diffuse maps are decoded on worker threads while meshes are built and uploaded below
+  Renderer::TextureCache textures;
+  Renderer::decodeTextures(textures, Materials);
 
-  Shader shader("src/vs.glsl", "src/fs.glsl");
+  Shader shader(multiDraw ? "src/vs_mdi.glsl" : "src/vs.glsl", "src/fs.glsl");
+  //in mdi mode meshes left out of scene batch are still drawn one by one with vs.glsl
+  std::vector<Shader> shaders{shader};
+  if(multiDraw) shaders.push_back(Shader("src/vs.glsl", "src/fs.glsl"));
+  Shader& meshShader = shaders.back();
 
+  meshOptimizer::OptimizeOptions loadOptions;
+  loadOptions.meshlets = true;
+  loadOptions.lodLevels = 4;
+  loadOptions.lodSource = path;
   std::vector<Renderer::Model> ObjModels;
-  for(int i=0; i<Objects.size(); i++) 
-    ObjModels.push_back(Renderer::LoadObject(Objects[i], Materials));
+  for(int i=0; i<Objects.size(); i++){
+    loadOptions.lodCache = path + "." + std::to_string(i) + ".lod";
+    ObjModels.push_back(Renderer::LoadObject(Objects[i], Materials, textures, loadOptions));
+  }
+  std::cout << "Textures: " << textures.loaded << " loaded for " << textures.lookups << " textured meshes\n";
+  //objects are culled through the tree, so frames don't touch ones out of view
+  scene::Tree sceneTree;
+  for(uint32_t i=0; i<ObjModels.size(); i++)
+    scene::insert(sceneTree, ObjModels[i].min, ObjModels[i].max, i);
 
-  glUseProgram(shader.ID);
-  GLint SetProj = glGetUniformLocation(shader.ID, "projection");
-  GLint SetView = glGetUniformLocation(shader.ID, "view");
+  //projection, view and viewPos locations of every shader
+  std::vector<std::array<GLint, 3>> SetCamera;
+  for(Shader& s : shaders)
+    SetCamera.push_back({glGetUniformLocation(s.ID, "projection"), glGetUniformLocation(s.ID, "view"), glGetUniformLocation(s.ID, "viewPos")});
   
-  GLint SetMesh[6];
-  SetMesh[0] = glGetUniformLocation(shader.ID, "material.ambient");
-  SetMesh[1] = glGetUniformLocation(shader.ID, "material.diffuse");
-  SetMesh[2] = glGetUniformLocation(shader.ID, "material.specular");
-  SetMesh[3] = glGetUniformLocation(shader.ID, "material.shininess");
-  SetMesh[4] = glGetUniformLocation(shader.ID, "material.diffuseM"); 
-  SetMesh[5] = glGetUniformLocation(shader.ID, "state"); 
+  GLint SetMesh[5];
+  SetMesh[0] = glGetUniformLocation(meshShader.ID, "materialId");
+  SetMesh[1] = glGetUniformLocation(meshShader.ID, "diffuseM"); 
+  SetMesh[2] = glGetUniformLocation(meshShader.ID, "state"); 
+  SetMesh[3] = glGetUniformLocation(meshShader.ID, "dequantize");
+  SetMesh[4] = glGetUniformLocation(meshShader.ID, "octNormals");
+
+  //all material parameters live in one uniform buffer, meshes only set materialId
+  Renderer::MaterialTable materialTable = Renderer::createMaterialTable(Materials);
+  for(Shader& s : shaders)
+    glUniformBlockBinding(s.ID, glGetUniformBlockIndex(s.ID, "MaterialBlock"), Renderer::MaterialTable::binding);
+
+  //mdi mode draws whole scene from shared buffers with a few indirect multi draws
+  GLint SetBatch[3];
+  SetBatch[0] = glGetUniformLocation(shader.ID, "drawOffset");
+  SetBatch[1] = glGetUniformLocation(shader.ID, "diffuseM");
+  SetBatch[2] = glGetUniformLocation(shader.ID, "diffuseArray");
+  //fs.glsl samples batch texture arrays from unit 1, it may not share unit 0 with diffuseM
+  for(Shader& s : shaders){
+    glUseProgram(s.ID);
+    glUniform1i(glGetUniformLocation(s.ID, "diffuseArray"), 1);
+  }
+  Renderer::SceneBatch sceneBatch;
+  if(multiDraw) sceneBatch = Renderer::buildSceneBatch(ObjModels);
         
 /* 
   SetLight[0] = glGetUniformLocation(shader.ID, "light.position");
@@ -87,11 +129,7 @@ int main(int32_t _argc, char** _argv){
   SetLight[3]= glGetUniformLocation(shader.ID, "light.specular");
   SetLight[4]= glGetUniformLocation(shader.ID, "Nr_Lights");
   */  
-  glUniform3f(glGetUniformLocation(shader.ID, "light.ambient"), 0.2f, 0.2f, 0.2f); 
-  glUniform3f(glGetUniformLocation(shader.ID, "light.diffuse"), 0.8f, 0.8f, 0.8f); 
-  glUniform3f(glGetUniformLocation(shader.ID, "light.specular"), 1.0f, 1.0f, 1.0f); 
-  
-  glUniform1i(glGetUniformLocation(shader.ID, "Nr_Lights"), lights); 
+  std::vector<glm::vec3> lightPositions;
   float offset = 17.0f;
   float radius = 24.0f;
   for (unsigned int i = 0; i < lights; i++){
@@ -102,14 +140,28 @@ int main(int32_t _argc, char** _argv){
     float y = displacement * 0.4f + 20.0f;  
     displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
     float z = cos(angle) * radius + displacement;
-    std::string name = "Lights[" + std::to_string(i) + "].position";
-    glUniform3f(glGetUniformLocation(shader.ID, name.c_str()), x, y, z); 
+    lightPositions.push_back(glm::vec3(x, y, z));
   }
-  GLint SetPos = glGetUniformLocation(shader.ID, "viewPos");
 
   glm::mat4 model = glm::mat4(1.0f); 
-  glUniformMatrix4fv(glGetUniformLocation(shader.ID, "model"), 1, GL_FALSE, &model[0][0]);
+  for(Shader& s : shaders){
+    glUseProgram(s.ID);
+    glUniform3f(glGetUniformLocation(s.ID, "light.ambient"), 0.2f, 0.2f, 0.2f); 
+    glUniform3f(glGetUniformLocation(s.ID, "light.diffuse"), 0.8f, 0.8f, 0.8f); 
+    glUniform3f(glGetUniformLocation(s.ID, "light.specular"), 1.0f, 1.0f, 1.0f); 
+    
+    glUniform1i(glGetUniformLocation(s.ID, "Nr_Lights"), lights); 
+    for (unsigned int i = 0; i < lights; i++){
+      std::string name = "Lights[" + std::to_string(i) + "].position";
+      glUniform3fv(glGetUniformLocation(s.ID, name.c_str()), 1, &lightPositions[i][0]); 
+    }
+    glUniformMatrix4fv(glGetUniformLocation(s.ID, "model"), 1, GL_FALSE, &model[0][0]);
+  }
   
+  Renderer::FrameStats frameStats;
+  Renderer::DrawList drawList;
+  float lastTitle = 0.0f;
+
   //main loop
   while(!glfwWindowShouldClose(window)){
     float currentFrame = glfwGetTime();
@@ -119,40 +171,78 @@ int main(int32_t _argc, char** _argv){
     glClearColor(0.06f, 0.06f, 0.06f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
-    glUseProgram(shader.ID);
     glm::mat4 view = glm::mat4(1.0f); 
     glm::mat4 projection = glm::mat4(1.0f);
     projection = glm::perspective(glm::radians(50.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
     view = cam.GetViewMatrix();
     
-    glUniform3fv(SetPos, 1, &cam.Pos[0]); 
-    glUniformMatrix4fv(SetProj, 1, GL_FALSE, &projection[0][0]);
-    glUniformMatrix4fv(SetView, 1, GL_FALSE, &view[0][0]);
+    for(size_t i=0; i<shaders.size(); i++){
+      glUseProgram(shaders[i].ID);
+      glUniform3fv(SetCamera[i][2], 1, &cam.Pos[0]); 
+      glUniformMatrix4fv(SetCamera[i][0], 1, GL_FALSE, &projection[0][0]);
+      glUniformMatrix4fv(SetCamera[i][1], 1, GL_FALSE, &view[0][0]);
+    }
 
-    for(auto& objMod : ObjModels)
-      Renderer::RenderObject(objMod, shader, SetMesh, Materials);
+    Renderer::View cullView = Renderer::makeView(projection, view, cam.Pos, model, (float)SCR_HEIGHT);
+    cullView.pixelError = pixelError;
+    cullView.stats = &frameStats;
+    frameStats.reset();
+    //visible meshes of all objects are sorted together, opaque ones by binds, transparent back to front
+    drawList.clear();
+    scene::CullStats sceneStats = scene::cull(sceneTree, cullView.planes, [&](uint32_t i){
+      Renderer::collectDraws(drawList, ObjModels[i], &cullView);
+    });
+    Renderer::sortDraws(drawList);
+    if(multiDraw) Renderer::submitBatch(sceneBatch, drawList, shader, SetBatch, meshShader, SetMesh, &cullView);
+    else Renderer::submitDraws(drawList, shader, SetMesh, &cullView);
+
+    //triangles submitted per LOD level and culled meshes, refreshed once a second
+    if(currentFrame - lastTitle > 1.0f){
+      lastTitle = currentFrame;
+      std::string title = "Object Loader | triangles " + std::to_string(frameStats.total()) + " | LOD";
+      for(unsigned int l=0; l<=loadOptions.lodLevels && l<Renderer::FrameStats::maxLevels; l++)
+        title += " " + std::to_string(frameStats.triangles[l]);
+      title += " | objects " + std::to_string(sceneStats.itemsVisible) + "/" + std::to_string(ObjModels.size());
+      title += " | culled " + std::to_string(frameStats.meshesCulled) + "/" + std::to_string(frameStats.meshesTested) + " meshes";
+      title += " | draw calls " + std::to_string(frameStats.drawCalls);
+      if(multiDraw) title += " (multi draw " + std::to_string(frameStats.multiDrawCalls) + ")";
+      title += " | state changes " + std::to_string(frameStats.stateChanges) + " (unsorted " + std::to_string(frameStats.stateChangesUnsorted) + ")";
+      glfwSetWindowTitle(window, title.c_str());
+    }
     
     glfwSwapBuffers(window);
     glfwPollEvents();
   }
 
+  if(multiDraw) Renderer::DestroySceneBatch(sceneBatch, ObjModels);
   for(auto& objMod : ObjModels)
     Renderer::DestroyModel(objMod);
+  Renderer::DestroyMaterialTable(materialTable);
+  Renderer::DestroyTextures(textures);
   
   terminate();
   return 0;
 }
 //Main end
 
-void init(GLFWwindow*& window, bool flip){
+//multiDraw asks for GL 4.3 context, it is turned off when that or gl_DrawID is missing
+void init(GLFWwindow*& window, bool flip, bool& multiDraw){
   glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, multiDraw ? 4 : 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
   window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Object Loader", NULL, NULL);
+  if(!window && multiDraw){
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Object Loader", NULL, NULL);
+  }
   glfwMakeContextCurrent(window);
   glewInit();
+  if(multiDraw && !Renderer::multiDrawSupported()){
+    std::cout << "Multi draw indirect needs GL 4.3 and ARB_shader_draw_parameters, drawing meshes one by one\n";
+    multiDraw = false;
+  }
 
   glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
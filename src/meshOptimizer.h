@@ -0,0 +1,1524 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "objLoader.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+  #include "glm/simd/common.h"
+  #define MESHOPTIMIZER_SSE2
+#elif (GLM_ARCH & GLM_ARCH_X86_BIT) && (defined(__SSE2__) || defined(_M_X64))
+  #include <emmintrin.h>
+  #define MESHOPTIMIZER_SSE2
+  #define MESHOPTIMIZER_GLM_SHIM
+#endif
+#if defined(MESHOPTIMIZER_SSE2) && defined(__F16C__)
+  #include <immintrin.h>
+#endif
+
+namespace meshOptimizer {
+
+//cluster of triangles drawn as one range of IndexedMesh::indices, bounds are in
+//model space
+struct Meshlet{
+  unsigned int indexOffset = 0, indexCount = 0;
+  unsigned int vertexCount = 0; //unique vertices referenced
+  glm::vec3 center = glm::vec3(0.0f); //bounding sphere
+  float radius = 0.0f;
+  glm::vec3 min = glm::vec3(0.0f), max = glm::vec3(0.0f);
+  glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f); //average triangle normal
+  float coneCutoff = 1.0f; //sine of normal spread around coneAxis, 1 - never backfacing
+};
+
+//true when every triangle of meshlet faces away from eye (counter clockwise front faces)
+inline bool meshletBackfacing(const Meshlet& m, const glm::vec3& eye){
+  glm::vec3 d = m.center - eye;
+  return glm::dot(d, m.coneAxis) >= m.coneCutoff * glm::length(d) + m.radius;
+}
+
+//simplified index buffer, error is geometric deviation in model units
+struct LodLevel{
+  std::vector<unsigned int> indices;
+  float error = 0.0f;
+};
+
+//mesh with unique vertices in the layout vs.glsl reads: position(3), normal(3),
+//uv(2), and 3 indices per triangle for glDrawElements
+struct IndexedMesh{
+  std::vector<float> vertices;
+  std::vector<unsigned int> indices;
+  std::string mtl;
+  unsigned int state = 0; // 0 - just vertices;  1 - vertices and texture 2 - vertices and normals 3 - all
+  std::vector<Meshlet> meshlets; //empty unless built, covers all indices in order
+  std::vector<LodLevel> lods; //coarser levels over the same vertices, finest first
+
+  size_t vertexCount() const{ return vertices.size() / 8; }
+};
+
+enum class VertexOrder : uint8_t { Keep, FirstUse, Morton };
+
+//vertex layouts Renderer::LoadObject can upload, bytes per vertex in brackets
+enum class VertexFormat : uint8_t {
+  Float, //[32] float position, normal, uv
+  Oct16, //[16] unorm16 position + pad, snorm16 octahedral normal, half uv
+  Packed1010102, //[16] unorm16 position + pad, snorm 2_10_10_10 normal, half uv
+  Oct8 //[12] unorm16 position, snorm8 octahedral normal, half uv
+};
+
+struct OptimizeOptions{
+  bool vertexCache = false; //reorder triangles for post-transform cache (Tipsify)
+  unsigned int cacheSize = 16; //simulated FIFO entries
+  bool overdraw = false; //reorder triangle clusters so outer, outward facing ones are drawn first
+  float overdrawThreshold = 1.05f; //how much ACMR may grow by splitting clusters
+  VertexOrder vertexOrder = VertexOrder::Keep; //renumber vertices for sequential fetch
+  VertexFormat vertexFormat = VertexFormat::Float; //layout of uploaded vertices, see quantizeMesh
+  bool meshlets = false; //split meshes into clusters with bounds for culling
+  unsigned int meshletVertices = 64, meshletTriangles = 124;
+  unsigned int lodLevels = 0; //coarser levels built by simplifyMesh, each with lodRatio of previous triangles
+  float lodRatio = 0.5f;
+  std::string lodCache; //file LOD levels are read from, or written to when missing or stale
+  std::string lodSource; //OBJ file the cache is validated against
+  unsigned int threads = 0; //meshes are processed in parallel, 0 - one per core
+};
+
+//post-transform cache simulation, counts sum up over meshes
+struct CacheStats{
+  size_t misses = 0, triangles = 0, vertices = 0;
+
+  float acmr() const{ return triangles ? float(misses) / triangles : 0.0f; } //average cache miss ratio, misses per triangle
+  float atvr() const{ return vertices ? float(misses) / vertices : 0.0f; } //average transformed vertex ratio, 1.0 is optimal
+
+  CacheStats& operator+=(const CacheStats& o){
+    misses += o.misses; triangles += o.triangles; vertices += o.vertices;
+    return *this;
+  }
+};
+
+struct OptimizeReport{
+  CacheStats before, after;
+
+  OptimizeReport& operator+=(const OptimizeReport& o){
+    before += o.before; after += o.after;
+    return *this;
+  }
+};
+
+inline uint64_t hashTriplet(unsigned int v, unsigned int vt, unsigned int vn){
+  uint64_t h = (uint64_t(v) << 32 | vt) * 0x9E3779B97F4A7C15ULL;
+  h ^= (h >> 29) ^ (uint64_t(vn) * 0xBF58476D1CE4E5B9ULL);
+  return h ^ (h >> 32);
+}
+
+//open addressing table from (v, vt, vn) triplet to vertex index. Keys are kept
+//once per unique vertex, slots only hold indices, so probing touches 4 bytes.
+struct VertexWelder{
+  std::vector<unsigned int> slots; //vertex index, ~0u - empty
+  std::vector<unsigned int> triplets; //3 per unique vertex
+  size_t mask;
+
+  VertexWelder(size_t corners){
+    size_t size = std::bit_ceil(std::max<size_t>(corners + corners / 2, 16));
+    slots.assign(size, ~0u);
+    mask = size - 1;
+    triplets.reserve(corners * 3 / 2);
+  }
+
+  unsigned int weld(unsigned int v, unsigned int vt, unsigned int vn){
+    size_t i = hashTriplet(v, vt, vn) & mask;
+    while(slots[i] != ~0u){
+      const unsigned int* t = &triplets[slots[i] * 3];
+      if(t[0] == v && t[1] == vt && t[2] == vn) return slots[i];
+      i = (i + 1) & mask;
+    }
+    slots[i] = static_cast<unsigned int>(triplets.size() / 3);
+    triplets.insert(triplets.end(), {v, vt, vn});
+    return slots[i];
+  }
+};
+
+//writes count vertices in vs.glsl layout from (v, vt, vn) triplets, out holds 8 floats
+//per vertex. Missing attributes get defaults (origin, +y normal, uv (0, 1)).
+inline void gatherVertices(const objLoader::Object& Object, const unsigned int* triplets, size_t count, float* out){
+  size_t vCount = Object.vertices.size() / 3, tCount = Object.texCoords.size() / 3, nCount = Object.normals.size() / 3;
+  const float* vs = Object.vertices.data();
+  const float* ns = Object.normals.data();
+  const float* ts = Object.texCoords.data();
+#ifdef MESHOPTIMIZER_SSE2
+  //3 float loads never read past the attribute, overlapping stores go front to back
+  //so normal overwrites position's 4th lane and uv normal's
+  auto load3 = [](const float* p){
+    return _mm_movelh_ps(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))), _mm_load_ss(p + 2));
+  };
+  const __m128 zero = _mm_setzero_ps(), up = _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f), uv = _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f);
+  for(size_t i=0; i<count; i++, triplets += 3, out += 8){
+    unsigned int v = triplets[0], t = triplets[1], n = triplets[2];
+    _mm_storeu_ps(out, v < vCount ? load3(vs + size_t(v) * 3) : zero);
+    _mm_storeu_ps(out + 3, n < nCount ? load3(ns + size_t(n) * 3) : up);
+    _mm_storel_pi(reinterpret_cast<__m64*>(out + 6), t < tCount ? _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ts + size_t(t) * 3))) : uv);
+  }
+#else
+  for(size_t i=0; i<count; i++, triplets += 3, out += 8){
+    unsigned int v = triplets[0], t = triplets[1], n = triplets[2];
+    if(v < vCount) std::copy_n(vs + size_t(v) * 3, 3, out);
+    else std::fill_n(out, 3, 0.0f);
+    if(n < nCount) std::copy_n(ns + size_t(n) * 3, 3, out + 3);
+    else{ out[3] = 0.0f; out[4] = 1.0f; out[5] = 0.0f; }
+    if(t < tCount) std::copy_n(ts + size_t(t) * 3, 2, out + 6);
+    else{ out[6] = 0.0f; out[7] = 1.0f; }
+  }
+#endif
+}
+
+//welds equal (v, vt, vn) corners of mesh into one vertex. Missing or out of range
+//normals and uvs get the defaults Renderer uses.
+IndexedMesh buildIndexed(const objLoader::Object& Object, const objLoader::Mesh& mesh){
+  IndexedMesh out;
+  out.mtl = mesh.mtl;
+  if(!Object.texCoords.empty()) out.state += 1;
+  if(!Object.normals.empty()) out.state += 2;
+
+  size_t corners = mesh.positions.size();
+  VertexWelder welder(corners);
+  out.indices.resize(corners);
+  for(size_t i=0; i<corners; i++){
+    unsigned int t = (i < mesh.texPositions.size()) ? mesh.texPositions[i] : 0;
+    unsigned int n = (i < mesh.normPositions.size()) ? mesh.normPositions[i] : 0;
+    out.indices[i] = welder.weld(mesh.positions[i], t, n);
+  }
+
+  out.vertices.resize(welder.triplets.size() / 3 * 8);
+  gatherVertices(Object, welder.triplets.data(), welder.triplets.size() / 3, out.vertices.data());
+  return out;
+}
+
+//simulates FIFO post-transform cache of cacheSize entries over indices
+CacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = 16){
+  CacheStats stats;
+  stats.triangles = indices.size() / 3;
+  std::vector<size_t> insertedAt(vertexCount, 0); //miss count when vertex entered cache
+  std::vector<bool> used(vertexCount, false);
+  for(unsigned int v : indices){
+    if(!used[v]){
+      used[v] = true;
+      stats.vertices++;
+    }
+    else if(stats.misses - insertedAt[v] < cacheSize)
+      continue;
+    insertedAt[v] = stats.misses;
+    stats.misses++;
+  }
+  return stats;
+}
+
+//Tipsify (Sander, Nehab, Barczak 2007): fans around a vertex, then picks next fanning
+//vertex among the ones just emitted that will still be in cache. Linear time, keeps
+//winding of every triangle.
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = 16){
+  size_t triangles = indices.size() / 3;
+  if(triangles == 0) return;
+
+  //vertex to triangle adjacency
+  std::vector<unsigned int> live(vertexCount, 0);
+  for(unsigned int v : indices) live[v]++;
+  std::vector<size_t> offsets(vertexCount + 1, 0);
+  for(size_t v=0; v<vertexCount; v++) offsets[v + 1] = offsets[v] + live[v];
+  std::vector<unsigned int> adjacency(indices.size());
+  {
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for(size_t i=0; i<indices.size(); i++)
+      adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+  }
+
+  std::vector<unsigned int> cacheTime(vertexCount, 0);
+  std::vector<bool> emitted(triangles, false);
+  std::vector<unsigned int> deadEnd;
+  std::vector<unsigned int> candidates;
+  std::vector<unsigned int> out;
+  out.reserve(indices.size());
+
+  unsigned int time = cacheSize + 1;
+  size_t cursor = 0; //next vertex tried when dead-end stack runs dry
+  long long fan = 0;
+  while(fan >= 0){
+    candidates.clear();
+    for(size_t a=offsets[fan]; a<offsets[fan + 1]; a++){
+      unsigned int t = adjacency[a];
+      if(emitted[t]) continue;
+      emitted[t] = true;
+      for(int k=0; k<3; k++){
+        unsigned int v = indices[t * 3 + k];
+        out.push_back(v);
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+        if(time - cacheTime[v] > cacheSize){
+          cacheTime[v] = time;
+          time++;
+        }
+      }
+    }
+
+    //candidate that stays in cache for its whole remaining fan, oldest first
+    fan = -1;
+    long long priority = -1;
+    for(unsigned int v : candidates){
+      if(live[v] == 0) continue;
+      long long p = 0;
+      if(time - cacheTime[v] + 2 * live[v] <= cacheSize) p = time - cacheTime[v];
+      if(p > priority){
+        priority = p;
+        fan = v;
+      }
+    }
+    if(fan >= 0) continue;
+
+    while(!deadEnd.empty()){
+      unsigned int v = deadEnd.back();
+      deadEnd.pop_back();
+      if(live[v] > 0){
+        fan = v;
+        break;
+      }
+    }
+    while(fan < 0 && cursor < vertexCount){
+      if(live[cursor] > 0) fan = static_cast<long long>(cursor);
+      cursor++;
+    }
+  }
+  indices.swap(out);
+}
+
+//cache misses of single triangle against FIFO state kept in insertedAt/misses
+inline unsigned int simulateTriangle(const unsigned int* t, std::vector<size_t>& insertedAt, std::vector<bool>& used, size_t& misses, unsigned int cacheSize){
+  unsigned int m = 0;
+  for(int k=0; k<3; k++){
+    unsigned int v = t[k];
+    if(used[v] && misses - insertedAt[v] < cacheSize) continue;
+    used[v] = true;
+    insertedAt[v] = misses++;
+    m++;
+  }
+  return m;
+}
+
+//orders clusters given by their first triangles (plus triangle count as the last
+//entry) by how far out and outward facing they are. Returns cluster draw order.
+std::vector<size_t> overdrawOrder(const std::vector<unsigned int>& indices, const std::vector<float>& vertices, const std::vector<size_t>& clusters){
+  //area weighted centroid and normal of mesh and every cluster
+  float mesh[3] = {0, 0, 0}, meshArea = 0;
+  std::vector<float> centroid((clusters.size() - 1) * 3, 0.0f), normal((clusters.size() - 1) * 3, 0.0f);
+  for(size_t c=0; c + 1 < clusters.size(); c++){
+    float area = 0;
+    for(size_t t=clusters[c]; t<clusters[c + 1]; t++){
+      const float* a = &vertices[indices[t * 3] * 8];
+      const float* b = &vertices[indices[t * 3 + 1] * 8];
+      const float* d = &vertices[indices[t * 3 + 2] * 8];
+      float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      float e2[3] = {d[0] - a[0], d[1] - a[1], d[2] - a[2]};
+      float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+      float w = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      for(int k=0; k<3; k++){
+        centroid[c * 3 + k] += (a[k] + b[k] + d[k]) / 3.0f * w;
+        normal[c * 3 + k] += n[k];
+      }
+      area += w;
+    }
+    for(int k=0; k<3; k++) mesh[k] += centroid[c * 3 + k];
+    meshArea += area;
+    if(area > 0)
+      for(int k=0; k<3; k++) centroid[c * 3 + k] /= area;
+  }
+  if(meshArea > 0)
+    for(int k=0; k<3; k++) mesh[k] /= meshArea;
+
+  std::vector<float> key(clusters.size() - 1);
+  for(size_t c=0; c<key.size(); c++){
+    const float* n = &normal[c * 3];
+    float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    key[c] = 0;
+    if(len > 0)
+      for(int k=0; k<3; k++) key[c] += (centroid[c * 3 + k] - mesh[k]) * n[k] / len;
+  }
+  std::vector<size_t> order(key.size());
+  for(size_t c=0; c<order.size(); c++) order[c] = c;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){ return key[a] > key[b]; });
+  return order;
+}
+
+//Sander, Nehab, Barczak 2007 linear overdraw ordering. Indices should be cache
+//optimized first: they are cut into clusters where the cache was flushed (all 3
+//vertices missed), clusters are split further as long as their ACMR stays within
+//threshold of the whole one, then clusters are sorted by how far out and outward
+//facing they are, so they tend to occlude the rest from any direction.
+void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<float>& vertices, unsigned int cacheSize = 16, float threshold = 1.05f){
+  size_t triangles = indices.size() / 3;
+  size_t vertexCount = vertices.size() / 8;
+  if(triangles < 2) return;
+
+  std::vector<unsigned int> tmiss(triangles); //misses of every triangle in current order
+  {
+    std::vector<size_t> insertedAt(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    size_t misses = 0;
+    for(size_t t=0; t<triangles; t++)
+      tmiss[t] = simulateTriangle(&indices[t * 3], insertedAt, used, misses, cacheSize);
+  }
+
+  std::vector<size_t> hard;
+  for(size_t t=0; t<triangles; t++)
+    if(t == 0 || tmiss[t] == 3) hard.push_back(t);
+  hard.push_back(triangles);
+
+  //clusters are drawn after arbitrary others, so each one is simulated from cold cache
+  std::vector<size_t> clusters; //first triangle of every cluster
+  std::vector<size_t> insertedAt(vertexCount, 0);
+  std::vector<bool> used(vertexCount, false);
+  size_t clock = 0;
+  for(size_t h=0; h + 1 < hard.size(); h++){
+    size_t first = hard[h], last = hard[h + 1];
+    size_t total = 0;
+    for(size_t t=first; t<last; t++) total += tmiss[t];
+    float limit = float(total) / (last - first) * threshold;
+
+    clusters.push_back(first);
+    clock += cacheSize + 1; //flush
+    size_t start = first, misses = 0;
+    for(size_t t=first; t<last; t++){
+      misses += simulateTriangle(&indices[t * 3], insertedAt, used, clock, cacheSize);
+      //split once running cluster is as cache friendly as the whole one
+      if(t + 1 < last && float(misses) / (t + 1 - start) <= limit){
+        clusters.push_back(t + 1);
+        clock += cacheSize + 1;
+        start = t + 1;
+        misses = 0;
+      }
+    }
+  }
+  clusters.push_back(triangles);
+
+  std::vector<size_t> order = overdrawOrder(indices, vertices, clusters);
+  std::vector<unsigned int> out;
+  out.reserve(indices.size());
+  for(size_t c : order)
+    out.insert(out.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+  indices.swap(out);
+}
+
+//fills bounds of meshlet from its index range
+void computeMeshletBounds(Meshlet& m, const std::vector<unsigned int>& indices, const std::vector<float>& vertices){
+  const unsigned int* idx = indices.data() + m.indexOffset;
+  glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+  for(unsigned int i=0; i<m.indexCount; i++){
+    glm::vec3 p(vertices[idx[i] * 8], vertices[idx[i] * 8 + 1], vertices[idx[i] * 8 + 2]);
+    lo = glm::min(lo, p);
+    hi = glm::max(hi, p);
+  }
+  m.min = lo;
+  m.max = hi;
+  m.center = (lo + hi) * 0.5f;
+  float r2 = 0.0f;
+  for(unsigned int i=0; i<m.indexCount; i++){
+    glm::vec3 p(vertices[idx[i] * 8], vertices[idx[i] * 8 + 1], vertices[idx[i] * 8 + 2]);
+    glm::vec3 d = p - m.center;
+    r2 = std::max(r2, glm::dot(d, d));
+  }
+  m.radius = std::sqrt(r2);
+
+  //cone of face normals, degenerate triangles don't count
+  std::vector<glm::vec3> normals;
+  normals.reserve(m.indexCount / 3);
+  glm::vec3 sum(0.0f);
+  for(unsigned int i=0; i + 2 < m.indexCount; i += 3){
+    glm::vec3 a(vertices[idx[i] * 8], vertices[idx[i] * 8 + 1], vertices[idx[i] * 8 + 2]);
+    glm::vec3 b(vertices[idx[i + 1] * 8], vertices[idx[i + 1] * 8 + 1], vertices[idx[i + 1] * 8 + 2]);
+    glm::vec3 c(vertices[idx[i + 2] * 8], vertices[idx[i + 2] * 8 + 1], vertices[idx[i + 2] * 8 + 2]);
+    glm::vec3 n = glm::cross(b - a, c - a);
+    float len = glm::length(n);
+    if(len <= 0.0f) continue;
+    normals.push_back(n / len);
+    sum += normals.back();
+  }
+  m.coneCutoff = 1.0f;
+  float len = glm::length(sum);
+  if(normals.empty() || len <= 0.0f) return;
+  m.coneAxis = sum / len;
+  float minDot = 1.0f;
+  for(const glm::vec3& n : normals)
+    minDot = std::min(minDot, glm::dot(n, m.coneAxis));
+  if(minDot > 0.0f) m.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+//greedy clustering: meshlet grows by adjacent triangle adding fewest new vertices,
+//then closest to its centroid, until maxVertices or maxTriangles is reached. Next
+//meshlet starts from the frontier of previous one. Indices are reordered so every
+//meshlet is a contiguous range.
+std::vector<Meshlet> buildMeshlets(std::vector<unsigned int>& indices, const std::vector<float>& vertices, unsigned int maxVertices = 64, unsigned int maxTriangles = 124){
+  std::vector<Meshlet> meshlets;
+  size_t triangles = indices.size() / 3, vertexCount = vertices.size() / 8;
+  if(triangles == 0) return meshlets;
+  maxVertices = std::max(maxVertices, 3u);
+  maxTriangles = std::max(maxTriangles, 1u);
+
+  std::vector<unsigned int> count(vertexCount, 0);
+  for(unsigned int v : indices) count[v]++;
+  std::vector<size_t> offsets(vertexCount + 1, 0);
+  for(size_t v=0; v<vertexCount; v++) offsets[v + 1] = offsets[v] + count[v];
+  std::vector<unsigned int> adjacency(indices.size());
+  {
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for(size_t i=0; i<indices.size(); i++)
+      adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+  }
+  std::vector<glm::vec3> centroids(triangles);
+  for(size_t t=0; t<triangles; t++){
+    glm::vec3 c(0.0f);
+    for(int k=0; k<3; k++)
+      c += glm::vec3(vertices[indices[t * 3 + k] * 8], vertices[indices[t * 3 + k] * 8 + 1], vertices[indices[t * 3 + k] * 8 + 2]);
+    centroids[t] = c / 3.0f;
+  }
+
+  std::vector<bool> emitted(triangles, false);
+  std::vector<unsigned int> vertexStamp(vertexCount, ~0u); //meshlet vertex belongs to
+  std::vector<unsigned int> candidateStamp(triangles, ~0u); //meshlet triangle is candidate of
+  std::vector<unsigned int> candidates;
+  std::vector<unsigned int> out;
+  out.reserve(indices.size());
+  size_t cursor = 0;
+  long long seed = -1;
+  glm::vec3 centroid(0.0f);
+
+  while(out.size() < indices.size()){
+    unsigned int id = static_cast<unsigned int>(meshlets.size());
+    Meshlet m;
+    m.indexOffset = static_cast<unsigned int>(out.size());
+    unsigned int tris = 0;
+    glm::vec3 sum(0.0f);
+
+    while(tris < maxTriangles && out.size() < indices.size()){
+      long long best = -1;
+      unsigned int bestNew = 4;
+      float bestDist = FLT_MAX;
+      for(size_t i=0; i<candidates.size();){
+        unsigned int t = candidates[i];
+        if(emitted[t]){
+          candidates[i] = candidates.back();
+          candidates.pop_back();
+          continue;
+        }
+        i++;
+        unsigned int fresh = 0;
+        for(int k=0; k<3; k++) fresh += vertexStamp[indices[t * 3 + k]] != id;
+        if(m.vertexCount + fresh > maxVertices || fresh > bestNew) continue;
+        glm::vec3 d = centroids[t] - centroid;
+        float dist = glm::dot(d, d);
+        if(fresh < bestNew || dist < bestDist){
+          best = t;
+          bestNew = fresh;
+          bestDist = dist;
+        }
+      }
+      if(best < 0 && seed >= 0 && !emitted[seed])
+        best = seed;
+      //no neighbour fits, next triangle in index order when it does (disconnected parts)
+      if(best < 0){
+        while(emitted[cursor]) cursor++;
+        unsigned int fresh = 0;
+        for(int k=0; k<3; k++) fresh += vertexStamp[indices[cursor * 3 + k]] != id;
+        if(m.vertexCount + fresh > maxVertices) break;
+        best = static_cast<long long>(cursor);
+      }
+      seed = -1;
+
+      unsigned int t = static_cast<unsigned int>(best);
+      emitted[t] = true;
+      tris++;
+      for(int k=0; k<3; k++){
+        unsigned int v = indices[t * 3 + k];
+        out.push_back(v);
+        if(vertexStamp[v] != id){
+          vertexStamp[v] = id;
+          m.vertexCount++;
+        }
+        for(size_t a=offsets[v]; a<offsets[v + 1]; a++){
+          unsigned int n = adjacency[a];
+          if(emitted[n] || candidateStamp[n] == id) continue;
+          candidateStamp[n] = id;
+          candidates.push_back(n);
+        }
+      }
+      sum += centroids[t];
+      centroid = sum / float(tris);
+    }
+    m.indexCount = tris * 3;
+    meshlets.push_back(m);
+
+    //next meshlet starts on frontier triangle closest to this one
+    float seedDist = FLT_MAX;
+    for(unsigned int t : candidates){
+      if(emitted[t]) continue;
+      glm::vec3 d = centroids[t] - centroid;
+      if(glm::dot(d, d) < seedDist){
+        seedDist = glm::dot(d, d);
+        seed = t;
+      }
+    }
+    candidates.clear();
+  }
+  indices.swap(out);
+  for(Meshlet& m : meshlets)
+    computeMeshletBounds(m, indices, vertices);
+  return meshlets;
+}
+
+//Tipsify inside every meshlet range on meshlet local vertex ids, so the clusters of
+//buildMeshlets and their bounds stay as they are
+void optimizeMeshletVertexCache(std::vector<unsigned int>& indices, const std::vector<Meshlet>& meshlets, size_t vertexCount, unsigned int cacheSize = 16){
+  std::vector<unsigned int> local(vertexCount, ~0u);
+  std::vector<unsigned int> global;
+  std::vector<unsigned int> range;
+  for(const Meshlet& m : meshlets){
+    unsigned int* idx = indices.data() + m.indexOffset;
+    global.clear();
+    range.resize(m.indexCount);
+    for(unsigned int i=0; i<m.indexCount; i++){
+      unsigned int& l = local[idx[i]];
+      if(l == ~0u){
+        l = static_cast<unsigned int>(global.size());
+        global.push_back(idx[i]);
+      }
+      range[i] = l;
+    }
+    optimizeVertexCache(range, global.size(), cacheSize);
+    for(unsigned int i=0; i<m.indexCount; i++)
+      idx[i] = global[range[i]];
+    for(unsigned int v : global) local[v] = ~0u;
+  }
+}
+
+//overdraw ordering with whole meshlets as clusters, indices are rewritten so
+//meshlets stay contiguous ranges in their new order
+void optimizeMeshletOverdraw(std::vector<unsigned int>& indices, const std::vector<float>& vertices, std::vector<Meshlet>& meshlets){
+  if(meshlets.size() < 2) return;
+  std::vector<size_t> clusters;
+  for(const Meshlet& m : meshlets) clusters.push_back(m.indexOffset / 3);
+  clusters.push_back(indices.size() / 3);
+  std::vector<size_t> order = overdrawOrder(indices, vertices, clusters);
+
+  std::vector<unsigned int> out;
+  out.reserve(indices.size());
+  std::vector<Meshlet> sorted;
+  sorted.reserve(meshlets.size());
+  for(size_t c : order){
+    sorted.push_back(meshlets[c]);
+    sorted.back().indexOffset = static_cast<unsigned int>(out.size());
+    out.insert(out.end(), indices.begin() + meshlets[c].indexOffset, indices.begin() + meshlets[c].indexOffset + meshlets[c].indexCount);
+  }
+  indices.swap(out);
+  meshlets.swap(sorted);
+}
+
+//packs 10 bits of every coordinate into 30 bit Z-curve code
+inline uint32_t mortonCode(uint32_t x, uint32_t y, uint32_t z){
+  auto spread = [](uint32_t v){
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+  };
+  return spread(x) | (spread(y) << 1) | (spread(z) << 2);
+}
+
+//renumbers vertices in order of first use by indices or by Morton code of their
+//position, so fetches walk the vertex buffer forward. Unreferenced vertices are dropped.
+void optimizeVertexFetch(IndexedMesh& mesh, VertexOrder order){
+  if(order == VertexOrder::Keep) return;
+  size_t vertexCount = mesh.vertexCount();
+  std::vector<unsigned int> remap(vertexCount, ~0u);
+  unsigned int next = 0;
+
+  if(order == VertexOrder::FirstUse){
+    for(unsigned int v : mesh.indices)
+      if(remap[v] == ~0u) remap[v] = next++;
+  }
+  else{
+    float lo[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, hi[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    std::vector<bool> used(vertexCount, false);
+    for(unsigned int v : mesh.indices) used[v] = true;
+    for(size_t v=0; v<vertexCount; v++){
+      if(!used[v]) continue;
+      for(int k=0; k<3; k++){
+        lo[k] = std::min(lo[k], mesh.vertices[v * 8 + k]);
+        hi[k] = std::max(hi[k], mesh.vertices[v * 8 + k]);
+      }
+    }
+    float extent = std::max({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2], FLT_MIN});
+    std::vector<std::pair<uint32_t, unsigned int>> codes;
+    for(size_t v=0; v<vertexCount; v++){
+      if(!used[v]) continue;
+      uint32_t q[3];
+      for(int k=0; k<3; k++)
+        q[k] = static_cast<uint32_t>((mesh.vertices[v * 8 + k] - lo[k]) / extent * 1023.0f + 0.5f);
+      codes.push_back({mortonCode(q[0], q[1], q[2]), static_cast<unsigned int>(v)});
+    }
+    std::stable_sort(codes.begin(), codes.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+    for(const auto& c : codes) remap[c.second] = next++;
+  }
+
+  std::vector<float> vertices(size_t(next) * 8);
+  for(size_t v=0; v<vertexCount; v++)
+    if(remap[v] != ~0u) std::copy_n(&mesh.vertices[v * 8], 8, &vertices[size_t(remap[v]) * 8]);
+  for(unsigned int& v : mesh.indices) v = remap[v];
+  for(LodLevel& lod : mesh.lods)
+    for(unsigned int& v : lod.indices) v = remap[v];
+  mesh.vertices.swap(vertices);
+}
+
+//------------------ simplification
+
+//symmetric 4x4 error quadric of planes (Garland, Heckbert 1997)
+struct Quadric{
+  double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+  Quadric& operator+=(const Quadric& q){
+    a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2;
+    bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+    return *this;
+  }
+
+  //sum of squared distances of p to the planes
+  double error(const float* p) const{
+    double x = p[0], y = p[1], z = p[2];
+    return a2*x*x + 2*ab*x*y + 2*ac*x*z + 2*ad*x + b2*y*y + 2*bc*y*z + 2*bd*y + c2*z*z + 2*cd*z + d2;
+  }
+};
+
+inline Quadric planeQuadric(double a, double b, double c, double d){
+  Quadric q;
+  q.a2 = a*a; q.ab = a*b; q.ac = a*c; q.ad = a*d; q.b2 = b*b;
+  q.bc = b*c; q.bd = b*d; q.c2 = c*c; q.cd = c*d; q.d2 = d*d;
+  return q;
+}
+
+//role of a vertex in collapses, as in meshoptimizer. Wedges are vertices sharing a
+//position, buildIndexed splits them along uv and normal seams.
+//Interior - only wedge, no open edges, may collapse onto any neighbour
+//Border - only wedge, one open edge in and out, collapses along border onto Border/Locked
+//Seam - one of two wedges whose open edges mirror each other, collapses along seam onto
+//Seam/Locked together with its twin, so both sides stay joined
+//Locked - anything else (corners, seam ends, more wedges, non-manifold), never moves
+enum class VertexKind : uint8_t { Interior, Border, Seam, Locked };
+
+//id of each vertex's position (lowest vertex with bit-equal xyz), wedges of a
+//position are linked into a ring through nextWedge
+std::vector<unsigned int> positionIds(const std::vector<float>& vertices, std::vector<unsigned int>& nextWedge){
+  size_t vertexCount = vertices.size() / 8;
+  auto key = [&](unsigned int v){
+    uint32_t k[3];
+    std::memcpy(k, &vertices[size_t(v) * 8], sizeof(k));
+    return std::make_tuple(k[0], k[1], k[2]);
+  };
+  std::vector<unsigned int> order(vertexCount);
+  for(size_t v=0; v<vertexCount; v++) order[v] = static_cast<unsigned int>(v);
+  std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b){ return key(a) < key(b); });
+
+  std::vector<unsigned int> position(vertexCount);
+  nextWedge.resize(vertexCount);
+  for(size_t i=0; i<vertexCount;){
+    size_t j = i;
+    while(j < vertexCount && key(order[j]) == key(order[i])) j++;
+    for(size_t k=i; k<j; k++){
+      position[order[k]] = order[i];
+      nextWedge[order[k]] = order[k + 1 < j ? k + 1 : i];
+    }
+    i = j;
+  }
+  return position;
+}
+
+//quadric error half-edge collapse towards targetIndexCount. Vertices only move onto
+//existing neighbours, so the result indexes the same vertex buffer. Quadrics are kept
+//per position, border edges add a plane across them so outlines keep their shape.
+//Vertices are classified every pass (see VertexKind). Returns error of the worst collapse.
+//origin, if given, holds a value per triangle that stays with it as indices are compacted.
+float simplifyMesh(std::vector<unsigned int>& indices, const std::vector<float>& vertices, size_t targetIndexCount, std::vector<unsigned int>* origin = nullptr){
+  size_t vertexCount = vertices.size() / 8;
+  auto pos = [&](unsigned int v){ return &vertices[size_t(v) * 8]; };
+  const unsigned int none = ~0u;
+
+  std::vector<unsigned int> nextWedge;
+  std::vector<unsigned int> position = positionIds(vertices, nextWedge);
+
+  //vertex to triangle adjacency of current indices
+  std::vector<unsigned int> count(vertexCount);
+  std::vector<size_t> offsets(vertexCount + 1);
+  std::vector<unsigned int> adjacency;
+  auto buildAdjacency = [&](){
+    std::fill(count.begin(), count.end(), 0);
+    for(unsigned int v : indices) count[v]++;
+    for(size_t v=0; v<vertexCount; v++) offsets[v + 1] = offsets[v] + count[v];
+    adjacency.resize(indices.size());
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for(size_t i=0; i<indices.size(); i++)
+      adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+  };
+  //directed edge a -> b in some triangle, between vertices or between their positions
+  auto hasEdge = [&](unsigned int a, unsigned int b){
+    for(size_t i=offsets[a]; i<offsets[a + 1]; i++){
+      const unsigned int* t = &indices[size_t(adjacency[i]) * 3];
+      for(int k=0; k<3; k++)
+        if(t[k] == a && t[(k + 1) % 3] == b) return true;
+    }
+    return false;
+  };
+  auto hasPositionEdge = [&](unsigned int a, unsigned int b){
+    unsigned int w = a;
+    do{
+      for(size_t i=offsets[w]; i<offsets[w + 1]; i++){
+        const unsigned int* t = &indices[size_t(adjacency[i]) * 3];
+        for(int k=0; k<3; k++)
+          if(t[k] == w && position[t[(k + 1) % 3]] == position[b]) return true;
+      }
+      w = nextWedge[w];
+    } while(w != a);
+    return false;
+  };
+
+  std::vector<Quadric> quadrics(vertexCount); //indexed by position id
+  buildAdjacency();
+  for(size_t i=0; i<indices.size(); i += 3){
+    glm::vec3 a = glm::make_vec3(pos(indices[i])), b = glm::make_vec3(pos(indices[i + 1])), c = glm::make_vec3(pos(indices[i + 2]));
+    glm::dvec3 n = glm::cross(glm::dvec3(b - a), glm::dvec3(c - a));
+    double len = glm::length(n);
+    if(len <= 0.0) continue;
+    n /= len;
+    Quadric q = planeQuadric(n.x, n.y, n.z, -glm::dot(n, glm::dvec3(a)));
+    for(int k=0; k<3; k++) quadrics[position[indices[i + k]]] += q;
+
+    //plane through border edge, perpendicular to triangle
+    for(int k=0; k<3; k++){
+      unsigned int e0 = indices[i + k], e1 = indices[i + (k + 1) % 3];
+      if(hasPositionEdge(e1, e0)) continue;
+      glm::dvec3 p0 = glm::make_vec3(pos(e0)), p1 = glm::make_vec3(pos(e1));
+      glm::dvec3 side = glm::cross(p1 - p0, n);
+      double sideLen = glm::length(side);
+      if(sideLen <= 0.0) continue;
+      side /= sideLen;
+      Quadric border = planeQuadric(side.x, side.y, side.z, -glm::dot(side, p0));
+      quadrics[position[e0]] += border;
+      quadrics[position[e1]] += border;
+    }
+  }
+
+  struct Collapse{
+    double cost;
+    unsigned int from, to;
+    unsigned int twinFrom, twinTo; //seam twin moved along, none otherwise
+  };
+  std::vector<Collapse> collapses;
+  std::vector<VertexKind> kind(vertexCount);
+  std::vector<unsigned int> openOut(vertexCount), openIn(vertexCount); //open edge neighbour, none if not exactly one
+  std::vector<unsigned int> openOutCount(vertexCount), openInCount(vertexCount);
+  std::vector<unsigned int> remap(vertexCount);
+  std::vector<bool> touched(vertexCount);
+  double worst = 0.0;
+
+  while(indices.size() > targetIndexCount){
+    //open edges (no opposite triangle edge) and vertex kinds of current indices
+    buildAdjacency();
+    std::fill(openOutCount.begin(), openOutCount.end(), 0);
+    std::fill(openInCount.begin(), openInCount.end(), 0);
+    for(size_t i=0; i<indices.size(); i += 3)
+      for(int k=0; k<3; k++){
+        unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+        if(hasEdge(b, a)) continue;
+        openOutCount[a]++;
+        openInCount[b]++;
+        openOut[a] = b;
+        openIn[b] = a;
+      }
+    for(size_t v=0; v<vertexCount; v++){
+      if(openOutCount[v] != 1 || openInCount[v] != 1) openOut[v] = openIn[v] = none;
+      unsigned int wedges = 0, twin = none;
+      for(unsigned int w = nextWedge[v]; w != v; w = nextWedge[w])
+        if(count[w]){
+          wedges++;
+          twin = w;
+        }
+      if(wedges == 0 && openOutCount[v] == 0 && openInCount[v] == 0) kind[v] = VertexKind::Interior;
+      else if(openOut[v] == none) kind[v] = VertexKind::Locked;
+      else if(wedges == 0)
+        kind[v] = !hasPositionEdge(openOut[v], v) && !hasPositionEdge(v, openIn[v]) ? VertexKind::Border : VertexKind::Locked;
+      else if(wedges == 1 && openOutCount[twin] == 1 && openInCount[twin] == 1)
+        kind[v] = VertexKind::Seam; //mirroring is checked when the twin collapse is picked
+      else kind[v] = VertexKind::Locked;
+    }
+
+    collapses.clear();
+    for(size_t i=0; i<indices.size(); i += 3)
+      for(int k=0; k<3; k++){
+        unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+        for(int dir=0; dir<2; dir++, std::swap(a, b)){
+          if(kind[a] == VertexKind::Locked || position[a] == position[b]) continue;
+          Collapse c{0.0, a, b, none, none};
+          if(kind[a] != VertexKind::Interior){
+            bool alongOpen = b == openOut[a] || b == openIn[a];
+            if(!alongOpen || kind[b] == VertexKind::Interior || (kind[b] != kind[a] && kind[b] != VertexKind::Locked)) continue;
+            if(kind[a] == VertexKind::Seam){
+              //twin runs the other way, its open neighbour at b's position is where it goes
+              unsigned int twin = nextWedge[a];
+              while(!count[twin]) twin = nextWedge[twin];
+              unsigned int target = b == openOut[a] ? openIn[twin] : openOut[twin];
+              if(target == none || position[target] != position[b]) continue;
+              c.twinFrom = twin;
+              c.twinTo = target;
+            }
+          }
+          Quadric q = quadrics[position[a]];
+          q += quadrics[position[b]];
+          c.cost = q.error(pos(b));
+          collapses.push_back(c);
+        }
+      }
+    if(collapses.empty()) break;
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y){ return x.cost < y.cost; });
+    //cheapest third per pass, so later passes see updated quadrics
+    double limit = collapses[collapses.size() / 3].cost;
+
+    for(size_t v=0; v<vertexCount; v++) remap[v] = static_cast<unsigned int>(v);
+    std::fill(touched.begin(), touched.end(), false);
+    size_t triangles = indices.size() / 3, target = targetIndexCount / 3;
+    size_t done = 0;
+
+    //counts triangles around from that collapse, false if moving from onto to flips one
+    //or joins to with a position it already shares an edge with elsewhere (link
+    //condition), which would fold two faces onto one edge
+    auto check = [&](unsigned int from, unsigned int to, unsigned int& removed){
+      const float* dest = pos(to);
+      unsigned int opposite[4], opposites = 0; //third corners of collapsing triangles
+      for(size_t a=offsets[from]; a<offsets[from + 1]; a++){
+        const unsigned int* t = &indices[adjacency[a] * 3];
+        if(t[0] != to && t[1] != to && t[2] != to) continue;
+        removed++;
+        if(opposites == 4) return false;
+        for(int k=0; k<3; k++)
+          if(t[k] != from && t[k] != to) opposite[opposites++] = position[t[k]];
+      }
+      for(size_t a=offsets[from]; a<offsets[from + 1]; a++){
+        const unsigned int* t = &indices[adjacency[a] * 3];
+        if(t[0] == to || t[1] == to || t[2] == to) continue;
+        for(int k=0; k<3; k++){
+          if(t[k] == from) continue;
+          if(position[t[k]] == position[to]) return false;
+          if(std::find(opposite, opposite + opposites, position[t[k]]) == opposite + opposites && (hasPositionEdge(to, t[k]) || hasPositionEdge(t[k], to)))
+            return false;
+        }
+        glm::vec3 p[3], q[3];
+        for(int k=0; k<3; k++){
+          p[k] = glm::make_vec3(pos(t[k]));
+          q[k] = t[k] == from ? glm::make_vec3(dest) : p[k];
+        }
+        glm::vec3 n0 = glm::cross(p[1] - p[0], p[2] - p[0]), n1 = glm::cross(q[1] - q[0], q[2] - q[0]);
+        if(glm::dot(n0, n1) <= 0.0f) return false;
+      }
+      return true;
+    };
+    //triangles around from change, keep their vertices out of this pass
+    auto touch = [&](unsigned int from){
+      for(size_t a=offsets[from]; a<offsets[from + 1]; a++)
+        for(int k=0; k<3; k++) touched[indices[adjacency[a] * 3 + k]] = true;
+    };
+
+    for(const Collapse& c : collapses){
+      if(c.cost > limit || triangles <= target) break;
+      if(touched[c.from] || touched[c.to]) continue;
+      bool twin = c.twinFrom != none;
+      if(twin && (touched[c.twinFrom] || touched[c.twinTo])) continue;
+
+      unsigned int removed = 0;
+      if(!check(c.from, c.to, removed) || (twin && !check(c.twinFrom, c.twinTo, removed))) continue;
+
+      touch(c.from);
+      remap[c.from] = c.to;
+      if(twin){
+        touch(c.twinFrom);
+        remap[c.twinFrom] = c.twinTo;
+      }
+      quadrics[position[c.to]] += quadrics[position[c.from]];
+      worst = std::max(worst, c.cost);
+      triangles -= std::min<size_t>(removed, triangles);
+      done++;
+    }
+    if(done == 0) break;
+
+    size_t w = 0;
+    for(size_t i=0; i<indices.size(); i += 3){
+      unsigned int a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+      if(a == b || b == c || a == c) continue;
+      if(origin) (*origin)[w / 3] = (*origin)[i / 3];
+      indices[w++] = a;
+      indices[w++] = b;
+      indices[w++] = c;
+    }
+    indices.resize(w);
+    if(origin) origin->resize(w / 3);
+  }
+  return static_cast<float>(std::sqrt(std::max(worst, 0.0)));
+}
+
+//simplifyMesh over positions only, for meshes whose seams lock it (flat shading gives
+//every face its own wedges). Each corner then takes the wedge its source triangle had
+//at that position, or the wedge whose normal is closest to the new face's normal, so
+//uv seams may smear but the surface stays closed.
+float simplifyPositions(std::vector<unsigned int>& indices, const std::vector<float>& vertices, size_t targetIndexCount){
+  std::vector<unsigned int> nextWedge;
+  std::vector<unsigned int> position = positionIds(vertices, nextWedge);
+  std::vector<unsigned int> source = indices;
+  std::vector<unsigned int> origin(indices.size() / 3);
+  for(size_t t=0; t<origin.size(); t++) origin[t] = static_cast<unsigned int>(t);
+  for(unsigned int& v : indices) v = position[v];
+  float error = simplifyMesh(indices, vertices, targetIndexCount, &origin);
+
+  for(size_t t=0; t<origin.size(); t++){
+    unsigned int* tri = &indices[t * 3];
+    const unsigned int* src = &source[size_t(origin[t]) * 3];
+    glm::vec3 a = glm::make_vec3(&vertices[size_t(tri[0]) * 8]), b = glm::make_vec3(&vertices[size_t(tri[1]) * 8]), c = glm::make_vec3(&vertices[size_t(tri[2]) * 8]);
+    glm::vec3 n = glm::cross(b - a, c - a);
+    for(int k=0; k<3; k++){
+      unsigned int p = tri[k], best = p;
+      bool own = false;
+      for(int j=0; j<3 && !own; j++)
+        if(position[src[j]] == p){
+          best = src[j];
+          own = true;
+        }
+      float bestDot = -FLT_MAX;
+      for(unsigned int w = p; !own; ){
+        float d = glm::dot(glm::make_vec3(&vertices[size_t(w) * 8 + 3]), n);
+        if(d > bestDot){
+          bestDot = d;
+          best = w;
+        }
+        w = nextWedge[w];
+        if(w == p) break;
+      }
+      tri[k] = best;
+    }
+  }
+  return error;
+}
+
+//up to levels coarser index buffers, each aiming at ratio of previous triangles. A level
+//simplifyMesh can't shrink by 10% (seams lock it) is built by simplifyPositions instead.
+//Stops early when even that no longer gets 10% smaller.
+std::vector<LodLevel> buildLods(const IndexedMesh& mesh, unsigned int levels, float ratio = 0.5f){
+  std::vector<LodLevel> lods;
+  const std::vector<unsigned int>* previous = &mesh.indices;
+  for(unsigned int l=0; l<levels; l++){
+    LodLevel lod;
+    lod.indices = *previous;
+    size_t target = static_cast<size_t>(previous->size() / 3 * ratio) * 3;
+    lod.error = simplifyMesh(lod.indices, mesh.vertices, target);
+    if(lod.indices.size() > previous->size() * 9 / 10){
+      lod.indices = *previous;
+      lod.error = simplifyPositions(lod.indices, mesh.vertices, target);
+    }
+    if(lod.indices.empty() || lod.indices.size() > previous->size() * 9 / 10) break;
+    if(!lods.empty()) lod.error = std::max(lod.error, lods.back().error);
+    lods.push_back(std::move(lod));
+    previous = &lods.back().indices;
+  }
+  return lods;
+}
+
+//------------------ LOD cache
+//Layout: LodCacheHeader, then per mesh uint64 vertexCount, indexCount, levelCount and
+//per level float error, uint64 count and the indices.
+
+struct LodCacheHeader{
+  char magic[8];
+  uint32_t version;
+  uint32_t levels;
+  float ratio;
+  uint32_t pad = 0;
+  uint64_t sourceSize;
+  int64_t sourceTime;
+  uint64_t sourceHash;
+  uint64_t meshCount;
+};
+
+const char lodCacheMagic[8] = {'O','B','J','L','L','O','D','\0'};
+const uint32_t lodCacheVersion = 3; //bumped when simplification changes, old levels are rebuilt
+
+bool lodCacheKey(const OptimizeOptions& options, size_t meshCount, LodCacheHeader& h){
+  objLoader::CacheHeader key{};
+  if(!objLoader::sourceKey(options.lodSource, key)) return false;
+  std::memcpy(h.magic, lodCacheMagic, 8);
+  h.version = lodCacheVersion;
+  h.levels = options.lodLevels;
+  h.ratio = options.lodRatio;
+  h.sourceSize = key.sourceSize;
+  h.sourceTime = key.sourceTime;
+  h.sourceHash = key.sourceHash;
+  h.meshCount = meshCount;
+  return true;
+}
+
+//fills lods of meshes if cache matches source, options and mesh sizes
+bool readLodCache(std::vector<IndexedMesh>& meshes, const OptimizeOptions& options){
+  LodCacheHeader key{}, h{};
+  if(!lodCacheKey(options, meshes.size(), key)) return false;
+  std::ifstream in(options.lodCache, std::ios::binary);
+  if(!in.read(reinterpret_cast<char*>(&h), sizeof(h)) || std::memcmp(&h, &key, sizeof(h)) != 0) return false;
+
+  std::vector<std::vector<LodLevel>> lods(meshes.size());
+  for(size_t i=0; i<meshes.size(); i++){
+    uint64_t sizes[3];
+    if(!in.read(reinterpret_cast<char*>(sizes), sizeof(sizes))) return false;
+    if(sizes[0] != meshes[i].vertexCount() || sizes[1] != meshes[i].indices.size() || sizes[2] > options.lodLevels) return false;
+    lods[i].resize(sizes[2]);
+    for(LodLevel& lod : lods[i]){
+      uint64_t count;
+      if(!in.read(reinterpret_cast<char*>(&lod.error), sizeof(float)) || !in.read(reinterpret_cast<char*>(&count), sizeof(count)) || count > sizes[1]) return false;
+      lod.indices.resize(count);
+      if(!in.read(reinterpret_cast<char*>(lod.indices.data()), count * sizeof(unsigned int))) return false;
+      for(unsigned int v : lod.indices)
+        if(v >= sizes[0]) return false;
+    }
+  }
+  for(size_t i=0; i<meshes.size(); i++)
+    meshes[i].lods = std::move(lods[i]);
+  return true;
+}
+
+bool writeLodCache(const std::vector<IndexedMesh>& meshes, const OptimizeOptions& options){
+  LodCacheHeader h{};
+  if(!lodCacheKey(options, meshes.size(), h)) return false;
+  std::string tmp = options.lodCache + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if(!out.is_open()) return false;
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    for(const IndexedMesh& m : meshes){
+      uint64_t sizes[3] = {m.vertexCount(), m.indices.size(), m.lods.size()};
+      out.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+      for(const LodLevel& lod : m.lods){
+        uint64_t count = lod.indices.size();
+        out.write(reinterpret_cast<const char*>(&lod.error), sizeof(float));
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        out.write(reinterpret_cast<const char*>(lod.indices.data()), count * sizeof(unsigned int));
+      }
+    }
+    if(!out) return false;
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, options.lodCache, ec);
+  return !ec;
+}
+
+//persistent workers behind parallelFor, so loops run per load or per frame don't pay
+//for creating threads. A job lives on its caller's stack and is queued once per helper
+//wanted; the caller works on it too and, when indices run out, takes its unstarted
+//entries back out of the queue and waits only for helpers already inside. Work that
+//calls parallelFor again can't deadlock, at worst the nested caller does all of it.
+struct ThreadPool{
+  struct Job{
+    std::atomic<size_t> next{0};
+    size_t count = 0;
+    void* work = nullptr;
+    void (*call)(void*, size_t) = nullptr;
+    unsigned int running = 0; //helpers inside, guarded by pool mutex
+
+    void run(){
+      for(size_t i = next++; i < count; i = next++)
+        call(work, i);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  std::deque<Job*> queue;
+  std::mutex mutex;
+  std::condition_variable wake, done;
+  bool stopping = false;
+
+  ThreadPool(unsigned int count){
+    for(unsigned int i=0; i<count; i++)
+      workers.emplace_back([this](){ loop(); });
+  }
+  ~ThreadPool(){
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for(std::thread& w : workers)
+      w.join();
+  }
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void loop(){
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true){
+      wake.wait(lock, [this](){ return stopping || !queue.empty(); });
+      if(stopping) return;
+      Job* job = queue.front();
+      queue.pop_front();
+      job->running++;
+      lock.unlock();
+      job->run();
+      lock.lock();
+      if(--job->running == 0) done.notify_all();
+    }
+  }
+
+  //runs work(i) for every i < count with up to helpers workers next to the caller
+  template<typename Work>
+  void run(size_t count, unsigned int helpers, Work& work){
+    Job job;
+    job.count = count;
+    job.work = &work;
+    job.call = [](void* w, size_t i){ (*static_cast<Work*>(w))(i); };
+    helpers = std::min(helpers, static_cast<unsigned int>(workers.size()));
+    if(helpers){
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.insert(queue.end(), helpers, &job);
+      }
+      if(helpers == 1) wake.notify_one();
+      else wake.notify_all();
+    }
+    job.run();
+    if(!helpers) return;
+    std::unique_lock<std::mutex> lock(mutex);
+    queue.erase(std::remove(queue.begin(), queue.end(), &job), queue.end());
+    done.wait(lock, [&](){ return job.running == 0; });
+  }
+};
+
+//process wide pool, one worker less than cores since callers work too
+inline ThreadPool& threadPool(){
+  static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+  return pool;
+}
+
+//calls work(i) for every i < count, indices are spread over threads (0 - one per core)
+//of threadPool(). Safe to call from inside work.
+template<typename Work>
+void parallelFor(size_t count, unsigned int threads, Work work){
+  threads = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+  threads = static_cast<unsigned int>(std::min<size_t>(threads, count));
+  if(threads <= 1){
+    for(size_t i=0; i<count; i++)
+      work(i);
+    return;
+  }
+  threadPool().run(count, threads - 1, work);
+}
+
+//runs enabled stages on every mesh, meshes are spread over threads. Reports stay
+//empty when no stage is enabled.
+std::vector<OptimizeReport> optimizeMeshes(std::vector<IndexedMesh>& meshes, const OptimizeOptions& options = OptimizeOptions()){
+  std::vector<OptimizeReport> reports(meshes.size());
+  if(!options.vertexCache && !options.overdraw && !options.meshlets && !options.lodLevels && options.vertexOrder == VertexOrder::Keep) return reports;
+
+  //levels are built and cached on welded meshes, before any stage reorders them
+  if(options.lodLevels && (options.lodCache.empty() || !readLodCache(meshes, options))){
+    parallelFor(meshes.size(), options.threads, [&](size_t i){
+      meshes[i].lods = buildLods(meshes[i], options.lodLevels, options.lodRatio);
+    });
+    size_t without = 0;
+    for(const IndexedMesh& m : meshes) without += m.lods.empty() && !m.indices.empty();
+    if(without)
+      std::cout << without << " of " << meshes.size() << " meshes got no LOD levels (too few triangles or vertices locked by seams)" << std::endl;
+    if(!options.lodCache.empty() && !writeLodCache(meshes, options))
+      std::cout << "Failed to write LOD cache: " << options.lodCache << std::endl;
+  }
+
+  parallelFor(meshes.size(), options.threads, [&](size_t i){
+    IndexedMesh& m = meshes[i];
+    reports[i].before = analyzeVertexCache(m.indices, m.vertexCount(), options.cacheSize);
+    if(options.vertexCache)
+      for(LodLevel& lod : m.lods)
+        optimizeVertexCache(lod.indices, m.vertexCount(), options.cacheSize);
+    //with meshlets the clusters come first, cache and overdraw order then work
+    //inside and between them instead of being cut apart by buildMeshlets
+    if(options.meshlets){
+      m.meshlets = buildMeshlets(m.indices, m.vertices, options.meshletVertices, options.meshletTriangles);
+      if(options.vertexCache)
+        optimizeMeshletVertexCache(m.indices, m.meshlets, m.vertexCount(), options.cacheSize);
+      if(options.overdraw)
+        optimizeMeshletOverdraw(m.indices, m.vertices, m.meshlets);
+    }
+    else{
+      if(options.vertexCache)
+        optimizeVertexCache(m.indices, m.vertexCount(), options.cacheSize);
+      if(options.overdraw)
+        optimizeOverdraw(m.indices, m.vertices, options.cacheSize, options.overdrawThreshold);
+    }
+    optimizeVertexFetch(m, options.vertexOrder);
+    reports[i].after = analyzeVertexCache(m.indices, m.vertexCount(), options.cacheSize);
+  });
+  return reports;
+}
+
+//------------------
+
+//compact vertex buffer. Positions are unorm16 inside the mesh AABB, dequantize maps
+//the normalized [0,1] attribute back to model space.
+struct QuantizedMesh{
+  std::vector<uint8_t> vertices;
+  VertexFormat format = VertexFormat::Float;
+  unsigned int stride = 32, normalOffset = 12, uvOffset = 24;
+  glm::mat4 dequantize = glm::mat4(1.0f);
+
+  size_t vertexCount() const{ return stride ? vertices.size() / stride : 0; }
+};
+
+#ifdef MESHOPTIMIZER_GLM_SHIM
+//glm/simd/common.h only declares its helpers when glm intrinsics are enabled
+typedef __m128 glm_vec4;
+inline glm_vec4 glm_vec4_add(glm_vec4 a, glm_vec4 b){ return _mm_add_ps(a, b); }
+inline glm_vec4 glm_vec4_sub(glm_vec4 a, glm_vec4 b){ return _mm_sub_ps(a, b); }
+inline glm_vec4 glm_vec4_mul(glm_vec4 a, glm_vec4 b){ return _mm_mul_ps(a, b); }
+inline glm_vec4 glm_vec4_abs(glm_vec4 x){ return _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF))); }
+inline glm_vec4 glm_vec4_clamp(glm_vec4 v, glm_vec4 minVal, glm_vec4 maxVal){ return _mm_max_ps(_mm_min_ps(v, maxVal), minVal); }
+#endif
+
+//AABB of positions in interleaved position/normal/uv vertices, lo and hi are
+//left at +-FLT_MAX when count is 0. simd=false runs the scalar loop.
+inline void positionBounds(const float* v, size_t count, float* lo, float* hi, [[maybe_unused]] bool simd = true){
+#ifdef MESHOPTIMIZER_SSE2
+  if(simd){
+    //two accumulator pairs hide min/max latency, 4th lane (normal x) is dropped
+    glm_vec4 lo0 = _mm_set1_ps(FLT_MAX), hi0 = _mm_set1_ps(-FLT_MAX), lo1 = lo0, hi1 = hi0;
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2, v += 16){
+      glm_vec4 a = _mm_loadu_ps(v), b = _mm_loadu_ps(v + 8);
+      lo0 = _mm_min_ps(lo0, a);
+      hi0 = _mm_max_ps(hi0, a);
+      lo1 = _mm_min_ps(lo1, b);
+      hi1 = _mm_max_ps(hi1, b);
+    }
+    if(i < count){
+      glm_vec4 a = _mm_loadu_ps(v);
+      lo0 = _mm_min_ps(lo0, a);
+      hi0 = _mm_max_ps(hi0, a);
+    }
+    alignas(16) float l[4], h[4];
+    _mm_store_ps(l, _mm_min_ps(lo0, lo1));
+    _mm_store_ps(h, _mm_max_ps(hi0, hi1));
+    for(int k=0; k<3; k++){
+      lo[k] = l[k];
+      hi[k] = h[k];
+    }
+    return;
+  }
+#endif
+  for(int k=0; k<3; k++){
+    lo[k] = FLT_MAX;
+    hi[k] = -FLT_MAX;
+  }
+  for(size_t i=0; i<count; i++, v += 8)
+    for(int k=0; k<3; k++){
+      lo[k] = std::min(lo[k], v[k]);
+      hi[k] = std::max(hi[k], v[k]);
+    }
+}
+
+//unorm16 positions, 8 bytes are stored per vertex so the 3 component layout relies
+//on normal being written afterwards over the last 2. Kernels below take simd=false
+//to run their scalar path, which gives the same bytes.
+inline void quantizePositions(const float* v, size_t count, const float* lo, const float* scale, uint8_t* out, unsigned int stride, bool simd = true){
+#ifdef MESHOPTIMIZER_SSE2
+  if(simd){
+    const glm_vec4 lo4 = _mm_setr_ps(lo[0], lo[1], lo[2], 0.0f);
+    const glm_vec4 scale4 = _mm_setr_ps(scale[0], scale[1], scale[2], 0.0f);
+    const glm_vec4 xyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    const glm_vec4 zero = _mm_setzero_ps(), top = _mm_set1_ps(65535.0f);
+    const __m128i bias = _mm_set1_epi32(32768), flip = _mm_set1_epi16(short(0x8000));
+    for(size_t i=0; i<count; i++, v += 8, out += stride){
+      glm_vec4 p = glm_vec4_mul(glm_vec4_sub(_mm_and_ps(_mm_loadu_ps(v), xyz), lo4), scale4);
+      __m128i q = _mm_cvtps_epi32(glm_vec4_clamp(p, zero, top));
+      //SSE2 has no unsigned saturating pack, shift into signed range and back
+      q = _mm_sub_epi32(q, bias);
+      q = _mm_xor_si128(_mm_packs_epi32(q, q), flip);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(out), q);
+    }
+    return;
+  }
+#endif
+  for(size_t i=0; i<count; i++, v += 8, out += stride){
+    uint16_t q[4] = {0, 0, 0, 0};
+    for(int k=0; k<3; k++)
+      q[k] = static_cast<uint16_t>(std::nearbyint(glm::clamp((v[k] - lo[k]) * scale[k], 0.0f, 65535.0f)));
+    std::memcpy(out, q, sizeof(q));
+  }
+}
+
+//octahedral normals in snorm16 (bits 16) or snorm8 (bits 8), 4 vertices per step
+inline void quantizeOctahedral(const float* v, size_t count, uint8_t* out, unsigned int stride, int bits, bool simd = true){
+  const float range = bits == 16 ? 32767.0f : 127.0f;
+  for(size_t i=0; i<count; i += 4){
+    size_t n = std::min<size_t>(4, count - i);
+    alignas(16) float x[4] = {}, y[4] = {}, z[4] = {};
+    for(size_t k=0; k<n; k++){
+      x[k] = v[(i + k) * 8 + 3];
+      y[k] = v[(i + k) * 8 + 4];
+      z[k] = v[(i + k) * 8 + 5];
+    }
+    alignas(16) int32_t qx[4], qy[4];
+#ifdef MESHOPTIMIZER_SSE2
+    if(simd){
+      const glm_vec4 one = _mm_set1_ps(1.0f), sign = _mm_set1_ps(-0.0f);
+      glm_vec4 x4 = _mm_load_ps(x), y4 = _mm_load_ps(y), z4 = _mm_load_ps(z);
+      glm_vec4 l1 = glm_vec4_add(glm_vec4_add(glm_vec4_abs(x4), glm_vec4_abs(y4)), glm_vec4_abs(z4));
+      glm_vec4 inv = _mm_div_ps(one, _mm_max_ps(l1, _mm_set1_ps(FLT_MIN)));
+      x4 = glm_vec4_mul(x4, inv);
+      y4 = glm_vec4_mul(y4, inv);
+      //lower hemisphere folds over the diagonals
+      glm_vec4 fx = glm_vec4_mul(glm_vec4_sub(one, glm_vec4_abs(y4)), _mm_or_ps(_mm_and_ps(x4, sign), one));
+      glm_vec4 fy = glm_vec4_mul(glm_vec4_sub(one, glm_vec4_abs(x4)), _mm_or_ps(_mm_and_ps(y4, sign), one));
+      glm_vec4 lower = _mm_cmplt_ps(z4, _mm_setzero_ps());
+      x4 = _mm_or_ps(_mm_and_ps(lower, fx), _mm_andnot_ps(lower, x4));
+      y4 = _mm_or_ps(_mm_and_ps(lower, fy), _mm_andnot_ps(lower, y4));
+      const glm_vec4 range4 = _mm_set1_ps(range), minus = _mm_set1_ps(-1.0f);
+      _mm_store_si128(reinterpret_cast<__m128i*>(qx), _mm_cvtps_epi32(glm_vec4_mul(glm_vec4_clamp(x4, minus, one), range4)));
+      _mm_store_si128(reinterpret_cast<__m128i*>(qy), _mm_cvtps_epi32(glm_vec4_mul(glm_vec4_clamp(y4, minus, one), range4)));
+    }
+    else
+#endif
+    for(size_t k=0; k<4; k++){
+      float inv = 1.0f / std::max(std::abs(x[k]) + std::abs(y[k]) + std::abs(z[k]), FLT_MIN);
+      float ox = x[k] * inv, oy = y[k] * inv;
+      if(z[k] < 0.0f){
+        //copysign like the SSE sign mask, -0 folds to -1
+        float fx = (1.0f - std::abs(oy)) * std::copysign(1.0f, ox);
+        float fy = (1.0f - std::abs(ox)) * std::copysign(1.0f, oy);
+        ox = fx; oy = fy;
+      }
+      qx[k] = static_cast<int32_t>(std::nearbyint(glm::clamp(ox, -1.0f, 1.0f) * range));
+      qy[k] = static_cast<int32_t>(std::nearbyint(glm::clamp(oy, -1.0f, 1.0f) * range));
+    }
+    for(size_t k=0; k<n; k++){
+      uint8_t* o = out + (i + k) * stride;
+      if(bits == 16){
+        int16_t q[2] = {static_cast<int16_t>(qx[k]), static_cast<int16_t>(qy[k])};
+        std::memcpy(o, q, sizeof(q));
+      }
+      else{
+        o[0] = static_cast<uint8_t>(static_cast<int8_t>(qx[k]));
+        o[1] = static_cast<uint8_t>(static_cast<int8_t>(qy[k]));
+      }
+    }
+  }
+}
+
+//normals as GL_INT_2_10_10_10_REV, w is left 0
+inline void quantize1010102(const float* v, size_t count, uint8_t* out, unsigned int stride, bool simd = true){
+  for(size_t i=0; i<count; i++, v += 8, out += stride){
+    alignas(16) int32_t q[4];
+#ifdef MESHOPTIMIZER_SSE2
+    if(simd){
+      glm_vec4 n = glm_vec4_clamp(_mm_loadu_ps(v + 3), _mm_set1_ps(-1.0f), _mm_set1_ps(1.0f));
+      _mm_store_si128(reinterpret_cast<__m128i*>(q), _mm_cvtps_epi32(glm_vec4_mul(n, _mm_set1_ps(511.0f))));
+    }
+    else
+#endif
+    for(int k=0; k<3; k++)
+      q[k] = static_cast<int32_t>(std::nearbyint(glm::clamp(v[3 + k], -1.0f, 1.0f) * 511.0f));
+    uint32_t packed = (uint32_t(q[0]) & 1023) | (uint32_t(q[1]) & 1023) << 10 | (uint32_t(q[2]) & 1023) << 20;
+    std::memcpy(out, &packed, sizeof(packed));
+  }
+}
+
+//float to half with round to nearest even like F16C, glm::packHalf2x16 rounds ties
+//away from zero and can differ in the last bit
+inline uint16_t halfFromFloat(float f){
+  uint32_t x = std::bit_cast<uint32_t>(f);
+  uint32_t sign = (x >> 16) & 0x8000, abs = x & 0x7FFFFFFF;
+  if(abs >= 0x7F800000) //inf, nan keeps a quiet payload bit
+    return static_cast<uint16_t>(sign | 0x7C00 | (abs > 0x7F800000 ? 0x200 | ((abs >> 13) & 0x3FF) : 0));
+  if(abs >= 0x477FF000) return static_cast<uint16_t>(sign | 0x7C00); //rounds past 65504
+  if(abs < 0x38800000){ //half denormal or zero
+    if(abs < 0x33000000) return static_cast<uint16_t>(sign);
+    uint32_t mant = (abs & 0x7FFFFF) | 0x800000;
+    int shift = 126 - int(abs >> 23);
+    uint32_t h = mant >> shift, rest = mant & ((1u << shift) - 1), half = 1u << (shift - 1);
+    h += rest > half || (rest == half && (h & 1));
+    return static_cast<uint16_t>(sign | h);
+  }
+  uint32_t h = ((abs >> 13) - (112 << 10)), rest = abs & 0x1FFF;
+  h += rest > 0x1000 || (rest == 0x1000 && (h & 1));
+  return static_cast<uint16_t>(sign | h);
+}
+
+//uvs as 2 half floats
+inline void quantizeUVs(const float* v, size_t count, uint8_t* out, unsigned int stride, [[maybe_unused]] bool simd = true){
+  for(size_t i=0; i<count; i++, v += 8, out += stride){
+    uint32_t packed;
+#if defined(MESHOPTIMIZER_SSE2) && defined(__F16C__)
+    if(simd)
+      packed = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_cvtps_ph(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + 6))), 0)));
+    else
+#endif
+    packed = uint32_t(halfFromFloat(v[6])) | uint32_t(halfFromFloat(v[7])) << 16;
+    std::memcpy(out, &packed, sizeof(packed));
+  }
+}
+
+//converts mesh vertices into format. Float is copied as it is.
+QuantizedMesh quantizeMesh(const IndexedMesh& mesh, VertexFormat format, bool simd = true){
+  QuantizedMesh out;
+  out.format = format;
+  size_t count = mesh.vertexCount();
+  if(format == VertexFormat::Float){
+    out.vertices.resize(count * 32);
+    std::memcpy(out.vertices.data(), mesh.vertices.data(), out.vertices.size());
+    return out;
+  }
+  out.stride = format == VertexFormat::Oct8 ? 12 : 16;
+  out.normalOffset = format == VertexFormat::Oct8 ? 6 : 8;
+  out.uvOffset = format == VertexFormat::Oct8 ? 8 : 12;
+
+  float lo[3], hi[3];
+  positionBounds(mesh.vertices.data(), count, lo, hi, simd);
+  float scale[3];
+  for(int k=0; k<3; k++){
+    if(count == 0) lo[k] = hi[k] = 0.0f;
+    float extent = hi[k] - lo[k];
+    scale[k] = extent > 0.0f ? 65535.0f / extent : 0.0f;
+    out.dequantize[k][k] = extent;
+    out.dequantize[3][k] = lo[k];
+  }
+
+  out.vertices.resize(count * out.stride);
+  uint8_t* o = out.vertices.data();
+  quantizePositions(mesh.vertices.data(), count, lo, scale, o, out.stride, simd);
+  if(format == VertexFormat::Packed1010102)
+    quantize1010102(mesh.vertices.data(), count, o + out.normalOffset, out.stride, simd);
+  else
+    quantizeOctahedral(mesh.vertices.data(), count, o + out.normalOffset, out.stride, format == VertexFormat::Oct16 ? 16 : 8, simd);
+  quantizeUVs(mesh.vertices.data(), count, o + out.uvOffset, out.stride, simd);
+  return out;
+}
+
+}//close namespace
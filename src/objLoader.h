@@ -1,12 +1,44 @@
 #pragma once 
 
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <charconv>
 #include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
-#include <sstream>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "glm/simd/platform.h"
+
+#if (GLM_ARCH & GLM_ARCH_AVX2_BIT) || ((GLM_ARCH & GLM_ARCH_X86_BIT) && defined(__AVX2__))
+  #include <immintrin.h>
+  #define OBJLOADER_SIMD_WIDTH 32
+#elif (GLM_ARCH & GLM_ARCH_SSE2_BIT) || ((GLM_ARCH & GLM_ARCH_X86_BIT) && (defined(__SSE2__) || defined(_M_X64)))
+  #include <emmintrin.h>
+  #define OBJLOADER_SIMD_WIDTH 16
+#endif
+
+#ifdef _WIN32
+  #define NOMINMAX
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
 namespace objLoader {
 
 struct Vec4{
@@ -40,13 +72,15 @@ struct Index {
   Index(Face v, Face vt, Face vn) : v(v), vt(vt), vn(vn){}
 };
 
+//index and vertex arrays take an optional memory resource, default is global heap
 struct Mesh{
-  std::vector<unsigned int> positions;
-  std::vector<unsigned int> texPositions;
-  std::vector<unsigned int> normPositions;
+  std::pmr::vector<unsigned int> positions;
+  std::pmr::vector<unsigned int> texPositions;
+  std::pmr::vector<unsigned int> normPositions;
   std::string mtl;
 
-  Mesh(std::vector<Index> pos, std::string mtl, unsigned int n, unsigned int tn, unsigned int nn) : mtl(mtl){
+  Mesh(std::vector<Index> pos, std::string mtl, unsigned int n, unsigned int tn, unsigned int nn, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+    : positions(resource), texPositions(resource), normPositions(resource), mtl(mtl){
     positions.reserve(pos.size()*3);
     for(const Index x : pos){
       positions.push_back(x.v.x - 1 - n);
@@ -67,16 +101,25 @@ struct Mesh{
     }
   }
 
+  //takes over 1-based file indices (3 per triangle) and rebases them in place
+  Mesh(std::pmr::vector<unsigned int>&& pos, std::pmr::vector<unsigned int>&& tex, std::pmr::vector<unsigned int>&& norm, std::string mtl, unsigned int n, unsigned int tn, unsigned int nn)
+    : positions(std::move(pos)), texPositions(std::move(tex)), normPositions(std::move(norm)), mtl(mtl){
+    for(unsigned int& x : positions) x -= 1 + n;
+    for(unsigned int& x : texPositions) x -= 1 + tn;
+    for(unsigned int& x : normPositions) x -= 1 + nn;
+  }
+
 };
 
 struct Object{
-  std::vector<float> vertices;
-  std::vector<float> texCoords;
-  std::vector<float> normals;
+  std::pmr::vector<float> vertices;
+  std::pmr::vector<float> texCoords;
+  std::pmr::vector<float> normals;
   
   std::string name;
   std::vector<Mesh> meshes;
-  Object(std::string name, std::vector<Vec3> Vertices, std::vector<Vec3> TexCoords, std::vector<Vec3> Normals, std::vector<Mesh> Meshes) : name(name), meshes(Meshes){
+  Object(std::string name, std::span<const Vec3> Vertices, std::span<const Vec3> TexCoords, std::span<const Vec3> Normals, std::vector<Mesh> Meshes, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+    : vertices(resource), texCoords(resource), normals(resource), name(name), meshes(std::move(Meshes)){
     vertices.reserve(Vertices.size() * 3);
     for(const Vec3 v : Vertices) {
       vertices.push_back(v.x);
@@ -98,6 +141,21 @@ struct Object{
   }
 };
 
+//triangles of one material in the layout vs.glsl reads: position(3), normal(3),
+//uv(2) per vertex, 3 vertices per triangle, ready for glBufferData
+struct InterleavedBatch{
+  std::pmr::vector<float> vertices;
+  std::string mtl;
+  unsigned int state = 0; // 0 - just vertices;  1 - vertices and texture 2 - vertices and normals 3 - all
+
+  InterleavedBatch(std::string mtl, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : vertices(resource), mtl(mtl){}
+};
+
+struct InterleavedObject{
+  std::string name;
+  std::vector<InterleavedBatch> batches; //one per material, in order of first use
+};
+
 struct Material{
   std::string name;
   std::string DiffuseMap;
@@ -123,105 +181,398 @@ struct Material{
   };
 };
 
-void parseString(std::vector<std::string>& tokens, const std::string& line, const std::string& delimiter){
-  int start=0;
-  int end;
+struct LoadOptions{
+  bool mapFile = false; //parse straight over mmaped file instead of getline
+  unsigned int threads = 1; //>1 parses mapped file in that many chunks, 0 - one per core
+  bool useCache = false; //reuse <path>.bin sidecar if it matches source, write it otherwise
+  std::pmr::memory_resource* scratch = nullptr; //temporaries, nullptr - monotonic arena per load
+  std::pmr::memory_resource* output = nullptr; //Object/Mesh arrays, nullptr - default resource
+};
+
+//read-only view of whole file, unmapped on destruction
+struct MappedFile{
+  const char* data = nullptr;
+  size_t size = 0;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = NULL;
+#else
+  int fd = -1;
+#endif
+
+  MappedFile(const std::string& path){
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(file == INVALID_HANDLE_VALUE) return;
+    LARGE_INTEGER fsize;
+    if(!GetFileSizeEx(file, &fsize) || fsize.QuadPart == 0) return;
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mapping == NULL) return;
+    data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if(data) size = static_cast<size_t>(fsize.QuadPart);
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) return;
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(p == MAP_FAILED) return;
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(p);
+    size = st.st_size;
+#endif
+  }
+  ~MappedFile(){
+#ifdef _WIN32
+    if(data) UnmapViewOfFile(data);
+    if(mapping != NULL) CloseHandle(mapping);
+    if(file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+    if(data) munmap(const_cast<char*>(data), size);
+    if(fd >= 0) ::close(fd);
+#endif
+  }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool isOpen() const{
+#ifdef _WIN32
+    return file != INVALID_HANDLE_VALUE;
+#else
+    return fd >= 0;
+#endif
+  }
+};
+
+//memory resource for big output arrays: blocks of 2 MiB and more are mmaped on
+//huge pages (MAP_HUGETLB, else transparent huge pages via madvise), smaller ones
+//and every block on Windows go to upstream
+struct HugePageResource : std::pmr::memory_resource{
+  static const size_t hugePage = 2 * 1024 * 1024;
+  std::pmr::memory_resource* upstream;
 
-  while ((end = line.find(delimiter, start)) != std::string::npos) {
-    tokens.push_back(line.substr(start, end - start));
-    start = end + delimiter.length();
+  HugePageResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) : upstream(upstream){}
+
+private:
+  void* do_allocate(size_t bytes, size_t alignment) override{
+#ifndef _WIN32
+    if(bytes >= hugePage && alignment <= hugePage){
+      size_t size = (bytes + hugePage - 1) & ~(hugePage - 1);
+  #ifdef MAP_HUGETLB
+      void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if(p != MAP_FAILED) return p;
+  #endif
+      p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if(p == MAP_FAILED) throw std::bad_alloc();
+  #ifdef MADV_HUGEPAGE
+      madvise(p, size, MADV_HUGEPAGE);
+  #endif
+      return p;
+    }
+#endif
+    return upstream->allocate(bytes, alignment);
+  }
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override{
+#ifndef _WIN32
+    if(bytes >= hugePage && alignment <= hugePage){
+      munmap(p, (bytes + hugePage - 1) & ~(hugePage - 1));
+      return;
+    }
+#endif
+    upstream->deallocate(p, bytes, alignment);
+  }
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override{
+    return this == &other;
   }
+};
 
-  if (start < line.length())
-    tokens.push_back(line.substr(start));
+inline bool isSpace(char c){
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
 }
 
-void parseFragments(std::vector<Index>& Pos, std::vector<std::string> tokens){
-  std::vector<int> v, vt, vn;
-  for(int i=1; i<tokens.size(); i++){
-    std::vector<std::string> parts;
-    parseString(parts, tokens[i], "/");
-    v.push_back(std::stoi(parts[0]));
-    if(parts.size() > 1 && !parts[1].empty())
-      vt.push_back(std::stoi(parts[1]));
-    else vt.push_back(0);
-    if(parts.size() > 2 && !parts[2].empty())
-      vn.push_back(std::stoi(parts[2]));
-    else vn.push_back(0);
-    parts.clear();
-  } 
+#ifdef OBJLOADER_SIMD_WIDTH
+//scanner works on blocks of OBJLOADER_SIMD_WIDTH bytes, bit i of a mask is byte p[i]
+  #if OBJLOADER_SIMD_WIDTH == 32
+typedef __m256i ScanBlock;
+inline ScanBlock loadBlock(const char* p){ return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline uint32_t matchMask(ScanBlock b, char c){ return _mm256_movemask_epi8(_mm256_cmpeq_epi8(b, _mm256_set1_epi8(c))); }
+inline uint32_t spaceMask(ScanBlock b){
+  __m256i t = _mm256_sub_epi8(b, _mm256_set1_epi8('\t')); //\t \n \v \f \r are 9..13
+  __m256i ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(4)), t);
+  return _mm256_movemask_epi8(_mm256_or_si256(ctl, _mm256_cmpeq_epi8(b, _mm256_set1_epi8(' '))));
+}
+  #else
+typedef __m128i ScanBlock;
+inline ScanBlock loadBlock(const char* p){ return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline uint32_t matchMask(ScanBlock b, char c){ return _mm_movemask_epi8(_mm_cmpeq_epi8(b, _mm_set1_epi8(c))); }
+inline uint32_t spaceMask(ScanBlock b){
+  __m128i t = _mm_sub_epi8(b, _mm_set1_epi8('\t'));
+  __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(4)), t);
+  return _mm_movemask_epi8(_mm_or_si128(ctl, _mm_cmpeq_epi8(b, _mm_set1_epi8(' '))));
+}
+  #endif
+inline uint32_t lowBits(size_t n){ return n >= 32 ? 0xFFFFFFFFu : (1u << n) - 1; }
+#endif
+
+//first c in [first, last) or last; limit >= last is end of readable memory,
+//so blocks may be loaded past last as long as they stay below limit
+const char* findByte(const char* first, const char* last, char c, const char* limit){
+#ifdef OBJLOADER_SIMD_WIDTH
+  while(first < last && limit - first >= OBJLOADER_SIMD_WIDTH){
+    uint32_t m = matchMask(loadBlock(first), c) & lowBits(last - first);
+    if(m) return first + std::countr_zero(m);
+    first += OBJLOADER_SIMD_WIDTH;
+  }
+  if(first >= last) return last;
+#endif
+  const void* p = std::memchr(first, c, last - first);
+  return p ? static_cast<const char*>(p) : last;
+}
 
-  for(int i=0; i<v.size()-2; i++){
-    Face g(v[0], v[i+1], v[i+2]);
-    Face t(0,0,0);
-    Face n(0,0,0);
-    if(!vt.empty()){
-      t.x = vt[0]; t.y=vt[i+1]; t.z = vt[i+2];
+//whitespace separated tokens of [first, last), replaces istringstream >> token
+void splitTokens(std::pmr::vector<std::string_view>& tokens, const char* first, const char* last, const char* limit){
+  tokens.clear();
+  const char* start = nullptr; //start of token in progress
+#ifdef OBJLOADER_SIMD_WIDTH
+  while(first < last && limit - first >= OBJLOADER_SIMD_WIDTH){
+    size_t n = std::min<size_t>(OBJLOADER_SIMD_WIDTH, last - first);
+    uint32_t space = spaceMask(loadBlock(first));
+    uint32_t valid = lowBits(n);
+    uint32_t pos = 0;
+    while(pos < n){
+      uint32_t rest = ((start ? space : ~space) & valid) >> pos;
+      if(!rest) break;
+      pos += std::countr_zero(rest);
+      if(start){
+        tokens.emplace_back(start, first + pos - start);
+        start = nullptr;
+      }
+      else
+        start = first + pos;
     }
-    if(!vn.empty()){
-      n.x = vn[0]; n.y=vn[i+1]; n.z = vn[i+2];
+    first += n;
+  }
+#endif
+  for(; first < last; first++){
+    if(isSpace(*first)){
+      if(start) tokens.emplace_back(start, first - start);
+      start = nullptr;
     }
-    Pos.push_back(Index(g,t,n));
+    else if(!start)
+      start = first;
+  }
+  if(start) tokens.emplace_back(start, last - start);
+}
+
+enum class NumberError : uint8_t { None, Empty, Invalid, OutOfRange };
+
+//correctly rounded, locale independent, whole token must be a number
+NumberError parseFloatSlow(std::string_view token, float& out){
+  const char* p = token.data();
+  const char* end = p + token.size();
+  if(p == end) return NumberError::Empty;
+  if(*p == '+' && end - p > 1 && p[1] != '-') p++;
+
+  auto res = std::from_chars(p, end, out);
+  if(res.ec == std::errc::result_out_of_range) return NumberError::OutOfRange;
+  if(res.ec != std::errc() || res.ptr != end) return NumberError::Invalid;
+  return NumberError::None;
+}
+
+//SWAR digit helpers, v holds 8 chars with the first one in the lowest byte
+inline int leadingDigits(uint64_t v){
+  uint64_t nonDigit = ((v + 0x4646464646464646) | (v - 0x3030303030303030)) & 0x8080808080808080;
+  return nonDigit ? std::countr_zero(nonDigit) >> 3 : 8;
+}
+
+inline uint64_t digitsValue(uint64_t v, int n){
+  if(n == 0) return 0;
+  v = (v - 0x3030303030303030) << (8 * (8 - n)); //drops chars after the digits, pads with leading zeros
+  v = v * 10 + (v >> 8);
+  v = (((v & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) + (((v >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+  return v & 0xFFFFFFFF;
+}
+
+//appends run of digits at p to m, 8 at a time; buffer must be zero padded past the digits
+inline const char* readDigits(const char* p, uint64_t& m, int64_t& count){
+  while(true){
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    int n = leadingDigits(v);
+    static const uint64_t scale[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+    m = m * scale[n] + digitsValue(v, n);
+    p += n;
+    count += n;
+    if(n < 8) return p;
+  }
+}
+
+//Clinger fast path: mantissa below 2^53 and |exponent| <= 22 gives exact double
+//rounding, the float cast is then exact unless double hit a float halfway point.
+//Everything else (long mantissas, big exponents, inf/nan, errors) goes to from_chars.
+//Token must end at a non-digit or at limit (end of readable memory); digits are read
+//straight from the buffer when it has slack past the token, from a padded copy otherwise.
+NumberError parseFloat(std::string_view token, float& out, const char* limit = nullptr){
+  static const double pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  if(token.empty()) return NumberError::Empty;
+  if(token.size() > 24 || std::endian::native != std::endian::little)
+    return parseFloatSlow(token, out);
+
+  const char* p = token.data();
+  char buf[40]; //zero padding lets readDigits load 8 bytes past any digit
+  if(!limit || limit - p < 40){
+    std::memset(buf, 0, sizeof(buf));
+    std::memcpy(buf, p, token.size());
+    p = buf;
+  }
+  const char* end = p + token.size();
+
+  bool neg = (*p == '-');
+  if(*p == '-' || *p == '+') p++;
+
+  uint64_t m = 0;
+  int64_t mDigits = 0;
+  int64_t e10 = 0;
+  p = readDigits(p, m, mDigits);
+  if(*p == '.'){
+    int64_t frac = 0;
+    p = readDigits(p + 1, m, frac);
+    e10 = -frac;
+    mDigits += frac;
+  }
+  if(mDigits == 0 || mDigits > 19)
+    return parseFloatSlow(token, out);
+
+  if(*p == 'e' || *p == 'E'){
+    p++;
+    bool eneg = false;
+    if(*p == '-' || *p == '+') eneg = (*p++ == '-');
+    const char* exp = p;
+    int64_t e = 0;
+    while(static_cast<unsigned char>(*p - '0') < 10 && e < 100000)
+      e = e * 10 + (*p++ - '0');
+    if(p == exp)
+      return parseFloatSlow(token, out);
+    e10 += eneg ? -e : e;
+  }
+  if(p != end || m > (uint64_t(1) << 53) || e10 < -22 || e10 > 22)
+    return parseFloatSlow(token, out);
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+  return parseFloatSlow(token, out); //x87 extended precision breaks exact rounding
+#endif
+  double d = static_cast<double>(m);
+  d = (e10 < 0) ? d / pow10[-e10] : d * pow10[e10];
+  if(d != 0.0){
+    if(d < FLT_MIN || d > FLT_MAX)
+      return parseFloatSlow(token, out);
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    if((bits & 0x1FFFFFFF) == 0x10000000) //tie between two floats
+      return parseFloatSlow(token, out);
+  }
+  out = static_cast<float>(neg ? -d : d);
+  return NumberError::None;
+}
+
+//parses n tokens starting at tokens[first] into out, stops at first malformed one
+NumberError parseFloats(const std::pmr::vector<std::string_view>& tokens, size_t first, size_t n, float* out, const char* limit = nullptr){
+  for(size_t i=0; i<n; i++){
+    NumberError e = parseFloat(tokens[first + i], out[i], limit);
+    if(e != NumberError::None) return e;
+  }
+  return NumberError::None;
+}
+
+//reads values of Ka/Kd/Ks/Ke/Ns/d lines, reports malformed ones
+bool parseMtlValues(const std::pmr::vector<std::string_view>& tokens, size_t n, float* out, const std::string& path, uint64_t li){
+  if(tokens.size() < n + 1){
+    std::cout<<"Error: Not enough arguments in "<<path<<" at line "<<li<<".\n";
+    return false;
   }
-  v.clear(); vt.clear(); vn.clear();
+  NumberError e = parseFloats(tokens, 1, n, out);
+  if(e == NumberError::OutOfRange)
+    std::cout<<"Error: Number out of range in "<<path<<" at line "<<li<<".\n";
+  else if(e != NumberError::None)
+    std::cout<<"Error: Invalid number in "<<path<<" at line "<<li<<".\n";
+  return e == NumberError::None;
 }
 
-void loadMtl(std::string path, std::vector<Material>& Materials){
+//false if file is missing or has malformed lines, which are then left at defaults.
+//Line and token buffers come from scratch, or a stack arena when it's nullptr.
+bool loadMtl(std::string path, std::vector<Material>& Materials, std::pmr::memory_resource* scratch = nullptr){
   std::ifstream mFile(path);
-  if(!mFile.is_open()) return;
+  if(!mFile.is_open()){
+    std::cout<<"Error: Couldn't open material file "<<path<<".\n";
+    return false;
+  }
   
-  std::string line;
+  char stack[4096];
+  std::pmr::monotonic_buffer_resource arena(stack, sizeof(stack));
+  if(!scratch) scratch = &arena;
+  std::pmr::string line(scratch);
+  std::pmr::vector<std::string_view> tokens(scratch);
   Material curMat;
+  uint64_t li = 0;
+  bool ok = true;
   
   while(std::getline(mFile, line)){
-    std::istringstream iss(line);
-    std::vector<std::string> tokens;
-    std::string token;
-
-    while(iss >> token)
-      tokens.push_back(token);
+    splitTokens(tokens, line.data(), line.data() + line.size(), line.data() + line.size());
 
     if(tokens.empty() || tokens[0][0] == '#')
       continue;
 
-    std::string op = tokens[0];
+    std::string_view op = tokens[0];
+    float values[3];
+    bool named = op == "newmtl" || op == "map_Ka" || op == "map_Kd" || op == "map_Ks" || op == "map_Bump" || op == "bump";
     
-    if(op == "newmtl"){
+    if(named && tokens.size() < 2){
+      std::cout<<"Error: Not enough arguments in "<<path<<" at line "<<li<<".\n";
+      ok = false;
+    }
+    else if(op == "newmtl"){
       if(curMat.name != ""){
         Materials.push_back(curMat);
       }
-      curMat = Material(tokens[1]);
+      curMat = Material(std::string(tokens[1]));
     }
     //------------------
     else if(op == "Ka"){
-      curMat.ambient[0] = std::stof(tokens[1]);   
-      curMat.ambient[1] = std::stof(tokens[2]);   
-      curMat.ambient[2] = std::stof(tokens[3]);   
+      if(parseMtlValues(tokens, 3, values, path, li))
+        std::copy(values, values + 3, curMat.ambient);
+      else ok = false;
     }
     //------------------
     else if(op == "Kd"){
-      curMat.diffuse[0] = std::stof(tokens[1]);   
-      curMat.diffuse[1] = std::stof(tokens[2]);   
-      curMat.diffuse[2] = std::stof(tokens[3]);   
+      if(parseMtlValues(tokens, 3, values, path, li))
+        std::copy(values, values + 3, curMat.diffuse);
+      else ok = false;
     }
     //------------------
     else if(op == "Ks"){
-      curMat.specular[0] = std::stof(tokens[1]);   
-      curMat.specular[1] = std::stof(tokens[2]);   
-      curMat.specular[2] = std::stof(tokens[3]);   
+      if(parseMtlValues(tokens, 3, values, path, li))
+        std::copy(values, values + 3, curMat.specular);
+      else ok = false;
     }
     //------------------
     else if(op == "Ke"){
-      curMat.emission[0] = std::stof(tokens[1]);   
-      curMat.emission[1] = std::stof(tokens[2]);   
-      curMat.emission[2] = std::stof(tokens[3]);
+      if(parseMtlValues(tokens, 3, values, path, li))
+        std::copy(values, values + 3, curMat.emission);
+      else ok = false;
     }
     //------------------
-    else if(op == "Ns")
-      curMat.sExponent = std::stof(tokens[1]);
+    else if(op == "Ns"){
+      if(parseMtlValues(tokens, 1, values, path, li)) curMat.sExponent = values[0];
+      else ok = false;
+    }
     //------------------
-    else if(op == "d" || op == "Tr")
-      curMat.opacity = std::stof(tokens[1]);
+    else if(op == "d" || op == "Tr"){
+      if(parseMtlValues(tokens, 1, values, path, li)) curMat.opacity = values[0];
+      else ok = false;
+    }
     //------------------
     else if(op == "map_Ka")
       curMat.AmbientMap = tokens[1];
@@ -234,133 +585,1122 @@ void loadMtl(std::string path, std::vector<Material>& Materials){
     //------------------
     else if(op == "map_Bump" || op == "bump")
       curMat.BumpMap = tokens[1];
+    li++;
   }
   if (curMat.name != "")
     Materials.push_back(curMat);
+  return ok;
 }
 
-bool loadObject(std::vector<Object>& Objects, std::vector<Material>& Materials, std::string path){
-  if(path.substr(path.size()-4,4) != ".obj") return false;
+enum class LineStatus : uint8_t { Ok, NotEnoughArguments, InvalidNumber, NumberOutOfRange, InvalidIndex };
 
-  std::ifstream file(path);
-  if(!file.is_open()) return false;
+//------------------ visitor interface
+//corner of a face: 1-based indices resolved against elements read so far
+//(negative ones too), 0 when part is missing
+struct Corner{
+  unsigned int v, vt, vn;
+};
 
-  if(Materials.empty()) 
-    Materials.push_back(Material("Default"));
+//SAX-style hooks called by parseObj in file order. Derive, hide the hooks you need
+//and pass the derived type, calls are resolved at compile time. Views are valid
+//only during the call. A visitor that needs to know which parts were negative may
+//declare onFace(const Corner*, const uint8_t* negative, size_t n) instead, bit k
+//of negative[i] is set when part k (v, vt, vn) of corner i was relative.
+struct ObjVisitor{
+  void onVertex(float, float, float){} //x, y, z, no support for w component
+  void onTexCoord(float, float, float){} //u, v, w
+  void onNormal(float, float, float){}
+  void onFace(const Corner*, size_t){} //corners, n
+  void onObject(std::string_view){}
+  void onGroup(std::string_view){} //empty when g has no name
+  void onUseMtl(std::string_view){}
+  void onMtllib(std::string_view){} //path
+};
 
-  std::string line;
-  uint64_t li = 0;
-  std::vector<Vec3> GeometryV;
-  std::vector<Vec3> TextureV;
-  std::vector<Vec3> NormalV;  //define current obj
-  std::vector<Index> Positions; 
+//tokenizer scratch and element counts used to resolve negative indices
+template<class Visitor>
+struct ObjReader{
+  Visitor& visitor;
+  unsigned int count[3] = {0, 0, 0}; //v, vt, vn read so far
+  uint64_t li = 0; //statement lines read so far, blank and comment lines aren't counted
+  const char* limit = nullptr; //end of readable memory for the scanner
+  bool localCounts = false; //counts start mid file, negative indices may reach before them
+
+  std::pmr::vector<std::string_view> tokens;
+  std::pmr::vector<Corner> corners;
+  std::pmr::vector<uint8_t> negative;
+
+  ObjReader(Visitor& visitor, std::pmr::memory_resource* scratch = std::pmr::get_default_resource())
+    : visitor(visitor), tokens(scratch), corners(scratch), negative(scratch){}
+};
+
+//decodes v, v/vt, v//vn or v/vt/vn in one pass. Missing parts are 0, negative
+//indices count back from count (elements read so far). Returns bitmask of
+//negative parts or -1 if malformed or reaching before element 1. With local
+//counts earlier elements may exist, so only the sign of out[k] tells that.
+int decodeIndex(std::string_view t, const unsigned int (&count)[3], unsigned int (&out)[3], bool local = false){
+  const char* p = t.data();
+  const char* end = p + t.size();
+  int negative = 0;
+  for(int k=0; k<3; k++){
+    out[k] = 0;
+    if(k > 0){
+      if(p == end) continue;
+      if(*p++ != '/') return -1;
+    }
+    bool neg = false;
+    if(p != end && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+    const char* digits = p;
+    uint64_t v = 0;
+    while(p != end && static_cast<unsigned char>(*p - '0') < 10 && v <= 0xFFFFFFFF)
+      v = v * 10 + (*p++ - '0');
+    if(p == digits){
+      if(k == 0 || neg) return -1;
+      continue;
+    }
+    if(v > 0xFFFFFFFF) return -1;
+    if(neg && (v == 0 || v > 0x7FFFFFFF || (!local && v > count[k]))) return -1;
+    out[k] = neg ? count[k] - static_cast<unsigned int>(v) + 1 : static_cast<unsigned int>(v);
+    if(neg) negative |= 1 << k;
+  }
+  return (p == end) ? negative : -1;
+}
+
+LineStatus numberStatus(NumberError e){
+  if(e == NumberError::None) return LineStatus::Ok;
+  if(e == NumberError::OutOfRange) return LineStatus::NumberOutOfRange;
+  return LineStatus::InvalidNumber;
+}
+
+template<class Visitor>
+LineStatus readFace(ObjReader<Visitor>& r){
+  size_t n = r.tokens.size() - 1;
+  if(r.corners.size() < n){
+    r.corners.resize(n);
+    r.negative.resize(n);
+  }
+  for(size_t i=0; i<n; i++){
+    unsigned int out[3];
+    int neg = decodeIndex(r.tokens[i + 1], r.count, out, r.localCounts);
+    if(neg < 0) return LineStatus::InvalidIndex;
+    r.corners[i] = {out[0], out[1], out[2]};
+    r.negative[i] = static_cast<uint8_t>(neg);
+  }
+  if constexpr(requires { r.visitor.onFace(r.corners.data(), r.negative.data(), n); })
+    r.visitor.onFace(r.corners.data(), r.negative.data(), n);
+  else
+    r.visitor.onFace(r.corners.data(), n);
+  return LineStatus::Ok;
+}
+
+//tokenizes line [first, last) and calls matching hook, never allocates once
+//scratch has grown. Unknown statements are counted but ignored.
+template<class Visitor>
+LineStatus readLine(ObjReader<Visitor>& r, const char* first, const char* last){
+  splitTokens(r.tokens, first, last, r.limit);
+  const std::pmr::vector<std::string_view>& tokens = r.tokens;
+  if(tokens.empty() || tokens[0][0] == '#')
+    return LineStatus::Ok;
+
+  std::string_view op = tokens[0];
+  if(op == "v"){
+    if(tokens.size()<4) return LineStatus::NotEnoughArguments;
+    float xyz[3];
+    NumberError e = parseFloats(tokens, 1, 3, xyz, r.limit);
+    if(e != NumberError::None) return numberStatus(e);
+    r.visitor.onVertex(xyz[0], xyz[1], xyz[2]);
+    r.count[0]++;
+  }
+  //------------------
+  else if(op == "vt"){
+    if(tokens.size()<2) return LineStatus::NotEnoughArguments;
+    float uvw[3] = {0.0, 0.0, 1.0};
+    if(tokens.size() == 2) uvw[2] = 0.0;
+    NumberError e = parseFloats(tokens, 1, std::min<size_t>(tokens.size()-1, 3), uvw, r.limit);
+    if(e != NumberError::None) return numberStatus(e);
+    r.visitor.onTexCoord(uvw[0], uvw[1], uvw[2]);
+    r.count[1]++;
+  }
+  //------------------
+  else if(op == "vn"){
+    if(tokens.size()<4) return LineStatus::NotEnoughArguments;
+    float xyz[3];
+    NumberError e = parseFloats(tokens, 1, 3, xyz, r.limit);
+    if(e != NumberError::None) return numberStatus(e);
+    r.visitor.onNormal(xyz[0], xyz[1], xyz[2]);
+    r.count[2]++;
+  }
+  //------------------
+  else if(op == "f"){
+    if(tokens.size()<4) return LineStatus::NotEnoughArguments;
+    LineStatus status = readFace(r);
+    if(status != LineStatus::Ok) return status;
+  }
+  //------------------
+  else if(op == "g")
+    r.visitor.onGroup(tokens.size() > 1 ? tokens[1] : std::string_view());
+  //------------------
+  else if(op == "o" || op == "usemtl" || op == "mtllib"){
+    if(tokens.size()<2) return LineStatus::NotEnoughArguments;
+    if(op == "o") r.visitor.onObject(tokens[1]);
+    else if(op == "usemtl") r.visitor.onUseMtl(tokens[1]);
+    else r.visitor.onMtllib(tokens[1]);
+  }
+  r.li++;
+  return LineStatus::Ok;
+}
+
+
+void reportError(LineStatus status, std::string_view op, uint64_t li){
+  if(status == LineStatus::NotEnoughArguments && op == "v")
+    std::cout<<"not enough arguments at line "<<li<<".\n";
+  else if(status == LineStatus::NotEnoughArguments)
+    std::cout<<"Error: Not enough arguments at line "<<li<<".\n";
+  else if(status == LineStatus::InvalidNumber)
+    std::cout<<"Error: Invalid number at line "<<li<<".\n";
+  else if(status == LineStatus::NumberOutOfRange)
+    std::cout<<"Error: Number out of range at line "<<li<<".\n";
+  else if(status == LineStatus::InvalidIndex)
+    std::cout<<"Error: Invalid index at line "<<li<<".\n";
+}
+
+//parses one line, malformed input is reported with line number
+template<class Visitor>
+bool parseLine(ObjReader<Visitor>& r, const char* first, const char* last){
+  LineStatus status = readLine(r, first, last);
+  if(status != LineStatus::Ok){
+    reportError(status, r.tokens[0], r.li);
+    return false;
+  }
+  return true;
+}
+
+template<class Visitor>
+bool parseBuffer(ObjReader<Visitor>& r, const char* first, const char* last){
+  r.limit = last;
+  while(first != last){
+    const char* eol = findByte(first, last, '\n', last);
+    if(!parseLine(r, first, eol)) return false;
+    first = (eol == last) ? last : eol + 1;
+  }
+  return true;
+}
+
+//parses .obj text in [first, last), calling visitor hooks in file order. Materials
+//aren't loaded, onMtllib gets the path. False on malformed input.
+template<class Visitor>
+bool parseObj(Visitor& visitor, const char* first, const char* last, std::pmr::memory_resource* scratch = nullptr){
+  std::pmr::monotonic_buffer_resource arena;
+  ObjReader<Visitor> r(visitor, scratch ? scratch : &arena);
+  return parseBuffer(r, first, last);
+}
+
+//same over memory-mapped file
+template<class Visitor>
+bool parseObj(Visitor& visitor, const std::string& path, std::pmr::memory_resource* scratch = nullptr){
+  MappedFile file(path);
+  if(!file.isOpen()) return false;
+  return parseObj(visitor, file.data, file.data + file.size, scratch);
+}
+
+//------------------ loadObject visitor
+//geometry and triangulated faces. Index arrays are moved into meshes, so they
+//live in output, the rest in scratch.
+struct ParseBuffers : ObjVisitor{
+  std::pmr::memory_resource* scratch;
+  std::pmr::memory_resource* output;
+
+  std::pmr::vector<Vec3> GeometryV;
+  std::pmr::vector<Vec3> TextureV;
+  std::pmr::vector<Vec3> NormalV;
+  std::pmr::vector<unsigned int> positions; 
+  std::pmr::vector<unsigned int> texPositions; 
+  std::pmr::vector<unsigned int> normPositions; //1-based file indices, 3 per triangle
+  unsigned int vcount = 0, vtcount = 0, vncount = 0; //elements before GeometryV[0] etc.
+
+  ParseBuffers(std::pmr::memory_resource* scratch, std::pmr::memory_resource* output)
+    : scratch(scratch), output(output), GeometryV(scratch), TextureV(scratch), NormalV(scratch),
+      positions(output), texPositions(output), normPositions(output){}
+
+  void onVertex(float x, float y, float z){ GeometryV.push_back(Vec3(x, y, z)); }
+  void onTexCoord(float u, float v, float w){ TextureV.push_back(Vec3(u, v, w)); }
+  void onNormal(float x, float y, float z){ NormalV.push_back(Vec3(x, y, z)); }
+
+  void addTriangle(const Corner& a, const Corner& b, const Corner& c){
+    positions.push_back(a.v);
+    positions.push_back(b.v);
+    positions.push_back(c.v);
+    texPositions.push_back(a.vt);
+    texPositions.push_back(b.vt);
+    texPositions.push_back(c.vt);
+    normPositions.push_back(a.vn);
+    normPositions.push_back(b.vn);
+    normPositions.push_back(c.vn);
+  }
+
+  //fan triangulation
+  void onFace(const Corner* corners, size_t n){
+    for(size_t i=2; i<n; i++)
+      addTriangle(corners[0], corners[i-1], corners[i]);
+  }
+};
+
+//builds Objects the way loadObject returns them, mtllib files are loaded into Materials
+struct ObjectBuilder : ParseBuffers{
+  std::vector<Object>& Objects;
+  std::vector<Material>& Materials;
   std::vector<Mesh> Meshes;
-  unsigned int vcount = 0, vtcount = 0, vncount = 0;
+  std::function<void(const Mesh&, const std::string&)> onMesh; //optional, called with mesh and object name
 
   bool firstObj = true;
+  bool materialsOk = true; //false once an mtllib file was missing or malformed
+  std::vector<std::string> mtllibs; //files loaded into Materials, the sidecar cache depends on them
   std::string mtl = "";
   std::string objName = "";
 
-  while(std::getline(file, line)){
-    std::istringstream iss(line);
-    std::vector<std::string> tokens;
-    std::string token;
-
-    while(iss >> token)
-      tokens.push_back(token);
+  ObjectBuilder(std::vector<Object>& Objects, std::vector<Material>& Materials, std::pmr::memory_resource* scratch, std::pmr::memory_resource* output)
+    : ParseBuffers(scratch, output), Objects(Objects), Materials(Materials){}
 
-    if(tokens.empty() || tokens[0][0] == '#')
-      continue;
+  void flushMesh(){
+    Meshes.push_back(Mesh(std::move(positions), std::move(texPositions), std::move(normPositions), mtl, vcount, vtcount, vncount)); 
+    positions.clear();
+    texPositions.clear();
+    normPositions.clear();
+    if(onMesh) onMesh(Meshes.back(), objName);
+  }
 
-    std::string op = tokens[0];
+  void onMtllib(std::string_view path){
+    mtllibs.push_back(std::string(path));
+    materialsOk &= loadMtl(mtllibs.back(), Materials, scratch);
+  }
+  //------------------
+  void onUseMtl(std::string_view name){
+    if (!positions.empty())
+      flushMesh();
+    mtl = name;
+  }
+  //------------------
+  void onObject(std::string_view name){
+    if(firstObj){
+      objName = name;
+      firstObj=false;
+    }
+    else{
+      flushMesh();
+      Objects.push_back(Object(objName, GeometryV, TextureV, NormalV, std::move(Meshes), output));
     
-    if(op == "v"){
-      if(tokens.size()<4){
-        std::cout<<"not enough arguments at line "<<li<<".\n";
-        return false;
-      }
-      GeometryV.push_back(Vec3(std::stof(tokens[1]), std::stof(tokens[2]), std::stof(tokens[3]))); //no support for w component
+      vcount += GeometryV.size();
+      vtcount += TextureV.size();
+      vncount += NormalV.size();
+      GeometryV.clear();
+      TextureV.clear();
+      NormalV.clear();
+      Meshes.clear();
+
+      objName = name;
     }
-    //------------------
-    else if(op == "vt"){
-      if(tokens.size()<2){
-        std::cout<<"Error: Not enough arguments at line "<<li<<".\n";
-        return false;
+  }
+  //------------------
+  void onGroup(std::string_view){
+    flushMesh();
+  }
+
+  //closes last object
+  void finish(){
+    if(!positions.empty()){
+      flushMesh();
+      Objects.push_back(Object(objName, GeometryV, TextureV, NormalV, std::move(Meshes), output));
+    }
+  }
+};
+
+//------------------ parallel parse
+enum class EventKind : uint8_t { Error, Mtllib, Usemtl, Object, Group, Reach };
+
+//boundary or error met by a worker, replayed in file order during merge
+struct ChunkEvent{
+  EventKind kind;
+  LineStatus status;
+  std::string_view op;
+  std::string_view name;  //views into mapped file
+  size_t v, vt, vn, face; //chunk-local counts when event was hit
+  uint64_t li;
+  unsigned int reach[3];  //negative indices reached this far before the chunk so far
+};
+
+//worker visitor: keeps v/vt/vn/f in chunk-local buffers, records everything else.
+//Counts start at 0, so entries from negative indices are rebased during merge.
+struct ChunkResult : ParseBuffers{
+  std::pmr::vector<ChunkEvent> events;
+  std::pmr::vector<size_t> relative[3]; //entries resolved from negative indices
+  unsigned int reach[3] = {0, 0, 0}; //how far they reached before chunk start, checked in merge
+  uint64_t lines = 0;
+
+  ChunkResult(std::pmr::memory_resource* scratch)
+    : ParseBuffers(scratch, scratch), events(scratch),
+      relative{std::pmr::vector<size_t>(scratch), std::pmr::vector<size_t>(scratch), std::pmr::vector<size_t>(scratch)}{}
+
+  void record(EventKind kind, LineStatus status, std::string_view op, std::string_view name){
+    events.push_back({kind, status, op, name, GeometryV.size(), TextureV.size(), NormalV.size(), positions.size(), lines, {reach[0], reach[1], reach[2]}});
+  }
+
+  void onFace(const Corner* corners, const uint8_t* negative, size_t n){
+    bool reached = false;
+    for(size_t i=0; i<n; i++){
+      const unsigned int parts[3] = {corners[i].v, corners[i].vt, corners[i].vn};
+      for(int k=0; k<3; k++){
+        int resolved = static_cast<int>(parts[k]);
+        if((negative[i] & (1 << k)) && resolved < 1 && static_cast<unsigned int>(1 - resolved) > reach[k]){
+          reach[k] = static_cast<unsigned int>(1 - resolved);
+          reached = true;
+        }
       }
-      else if(tokens.size() == 2)
-        TextureV.push_back(Vec3(std::stof(tokens[1]), 0.0, 0.0));
-      else if(tokens.size() == 3)
-        TextureV.push_back(Vec3(std::stof(tokens[1]), std::stof(tokens[2]), 1.0));
-      else 
-        TextureV.push_back(Vec3(std::stof(tokens[1]), std::stof(tokens[2]), std::stof(tokens[3])));
     }
-    //------------------
-    else if(op == "vn"){
-      if(tokens.size()<4){
-        std::cout<<"Error: Not enough arguments at line "<<li<<".\n";
-        return false;
+    if(reached) record(EventKind::Reach, LineStatus::Ok, "f", {});
+    for(size_t i=2; i<n; i++){
+      size_t at = positions.size();
+      for(int k=0; k<3; k++){
+        if(negative[0] & (1 << k)) relative[k].push_back(at);
+        if(negative[i-1] & (1 << k)) relative[k].push_back(at + 1);
+        if(negative[i] & (1 << k)) relative[k].push_back(at + 2);
       }
-      NormalV.push_back(Vec3(std::stof(tokens[1]), std::stof(tokens[2]), std::stof(tokens[3])));
+      addTriangle(corners[0], corners[i-1], corners[i]);
     }
-    //------------------
-    else if(op == "f"){
-      if(tokens.size()<4){
-        std::cout<<"Error: Not enough arguments at line "<<li<<".\n";
+  }
+  void onObject(std::string_view name){ record(EventKind::Object, LineStatus::Ok, {}, name); }
+  void onGroup(std::string_view name){ record(EventKind::Group, LineStatus::Ok, {}, name); }
+  void onUseMtl(std::string_view name){ record(EventKind::Usemtl, LineStatus::Ok, {}, name); }
+  void onMtllib(std::string_view path){ record(EventKind::Mtllib, LineStatus::Ok, {}, path); }
+};
+
+void parseChunk(ChunkResult& c, const char* first, const char* last){
+  ObjReader<ChunkResult> r(c, c.scratch);
+  r.limit = last;
+  r.localCounts = true;
+  while(first != last){
+    const char* eol = findByte(first, last, '\n', last);
+    c.lines = r.li;
+    LineStatus status = readLine(r, first, eol);
+    if(status != LineStatus::Ok){
+      c.record(EventKind::Error, status, r.tokens[0], {});
+      return;
+    }
+    first = (eol == last) ? last : eol + 1;
+  }
+  c.lines = r.li;
+}
+
+
+//how far a chunk has been merged
+struct MergeCursor{
+  size_t v = 0, vt = 0, vn = 0, face = 0;
+  size_t relative[3] = {0, 0, 0};
+  unsigned int base[3]; //global v/vt/vn counts before chunk
+};
+
+//appends chunk data up to (v, vt, vn, face) onto serial state
+void mergeChunk(ObjectBuilder& s, const ChunkResult& c, MergeCursor& m, size_t v, size_t vt, size_t vn, size_t face){
+  s.GeometryV.insert(s.GeometryV.end(), c.GeometryV.begin() + m.v, c.GeometryV.begin() + v);
+  s.TextureV.insert(s.TextureV.end(), c.TextureV.begin() + m.vt, c.TextureV.begin() + vt);
+  s.NormalV.insert(s.NormalV.end(), c.NormalV.begin() + m.vn, c.NormalV.begin() + vn);
+
+  const std::pmr::vector<unsigned int>* from[3] = {&c.positions, &c.texPositions, &c.normPositions};
+  std::pmr::vector<unsigned int>* to[3] = {&s.positions, &s.texPositions, &s.normPositions};
+  for(int k=0; k<3; k++){
+    size_t at = to[k]->size();
+    to[k]->insert(to[k]->end(), from[k]->begin() + m.face, from[k]->begin() + face);
+    const std::pmr::vector<size_t>& rel = c.relative[k];
+    for(; m.relative[k] < rel.size() && rel[m.relative[k]] < face; m.relative[k]++)
+      (*to[k])[at + rel[m.relative[k]] - m.face] += m.base[k];
+  }
+  m.v = v; m.vt = vt; m.vn = vn; m.face = face;
+}
+
+//splits buffer at newlines into chunks parsed on their own threads, then replays
+//chunk results in order so the output is identical to parseBuffer
+bool parseBufferParallel(ObjectBuilder& s, const char* first, const char* last, unsigned int threads){
+  size_t size = last - first;
+  std::vector<const char*> cuts;
+  cuts.push_back(first);
+  for(unsigned int i=1; i<threads; i++){
+    const char* cut = first + size / threads * i;
+    if(cut < cuts.back()) cut = cuts.back();
+    const char* eol = findByte(cut, last, '\n', last);
+    cuts.push_back(eol == last ? last : eol + 1);
+  }
+  cuts.push_back(last);
+
+  //arena per chunk, dropped after merge. Upstream is the default resource since workers
+  //allocate concurrently and caller's scratch needn't be thread-safe.
+  std::vector<std::pmr::monotonic_buffer_resource> arenas(threads);
+  std::vector<ChunkResult> chunks;
+  chunks.reserve(threads);
+  for(unsigned int i=0; i<threads; i++)
+    chunks.emplace_back(&arenas[i]);
+  std::vector<std::thread> workers;
+  for(unsigned int i=1; i<threads; i++)
+    workers.emplace_back(parseChunk, std::ref(chunks[i]), cuts[i], cuts[i+1]);
+  parseChunk(chunks[0], cuts[0], cuts[1]);
+  for(std::thread& w : workers)
+    w.join();
+
+  uint64_t lineBase = 0; //prefix sum of lines in earlier chunks
+  for(const ChunkResult& c : chunks){
+    MergeCursor m;
+    m.base[0] = s.vcount + s.GeometryV.size();
+    m.base[1] = s.vtcount + s.TextureV.size();
+    m.base[2] = s.vncount + s.NormalV.size();
+    for(const ChunkEvent& e : c.events){
+      mergeChunk(s, c, m, e.v, e.vt, e.vn, e.face);
+      if(e.kind == EventKind::Error){
+        reportError(e.status, e.op, lineBase + e.li);
         return false;
       }
-      parseFragments(Positions, tokens);
+      else if(e.kind == EventKind::Reach){
+        if(e.reach[0] > m.base[0] || e.reach[1] > m.base[1] || e.reach[2] > m.base[2]){
+          reportError(LineStatus::InvalidIndex, e.op, lineBase + e.li);
+          return false;
+        }
+      }
+      else if(e.kind == EventKind::Mtllib) s.onMtllib(e.name);
+      else if(e.kind == EventKind::Usemtl) s.onUseMtl(e.name);
+      else if(e.kind == EventKind::Object) s.onObject(e.name);
+      else s.onGroup(e.name);
     }
-    //------------------
-    else if(op == "mtllib"){
-      loadMtl(tokens[1], Materials);
+    mergeChunk(s, c, m, c.GeometryV.size(), c.TextureV.size(), c.NormalV.size(), c.positions.size());
+    lineBase += c.lines;
+  }
+  return true;
+}
+
+
+//mtllibs gets material files the object referenced
+bool loadObjectMapped(std::vector<Object>& Objects, std::vector<Material>& Materials, const std::string& path, unsigned int threads, const LoadOptions& options, std::vector<std::string>& mtllibs){
+  MappedFile file(path);
+  if(!file.isOpen()) return false;
+
+  if(Materials.empty()) 
+    Materials.push_back(Material("Default"));
+
+  std::pmr::monotonic_buffer_resource arena(std::pmr::new_delete_resource()); //whole load's scratch, released at once
+  ObjectBuilder s(Objects, Materials, options.scratch ? options.scratch : &arena, options.output ? options.output : std::pmr::get_default_resource());
+  if(threads > 1){
+    if(!parseBufferParallel(s, file.data, file.data + file.size, threads)) return false;
+  }
+  else{
+    ObjReader<ObjectBuilder> r(s, s.scratch);
+    if(!parseBuffer(r, file.data, file.data + file.size)) return false;
+  }
+  s.finish();
+  mtllibs = std::move(s.mtllibs);
+  return s.materialsOk;
+}
+
+//getline path
+bool loadObjectText(std::vector<Object>& Objects, std::vector<Material>& Materials, const std::string& path, const LoadOptions& options, std::vector<std::string>& mtllibs){
+  std::ifstream file(path);
+  if(!file.is_open()) return false;
+
+  if(Materials.empty()) 
+    Materials.push_back(Material("Default"));
+
+  std::pmr::monotonic_buffer_resource arena(std::pmr::new_delete_resource());
+  ObjectBuilder s(Objects, Materials, options.scratch ? options.scratch : &arena, options.output ? options.output : std::pmr::get_default_resource());
+  ObjReader<ObjectBuilder> r(s, s.scratch);
+  std::pmr::string line(s.scratch);
+  while(std::getline(file, line)){
+    r.limit = line.data() + line.size();
+    if(!parseLine(r, line.data(), r.limit)) return false;
+  }
+  s.finish();
+  mtllibs = std::move(s.mtllibs);
+
+  return s.materialsOk;
+}
+
+//------------------ interleaved loader
+//visitor writing faces straight into per-material interleaved batches. Geometry
+//is kept for the whole file since face indices are global.
+struct InterleavedBuilder : ObjVisitor{
+  std::vector<InterleavedObject>& Objects;
+  std::vector<Material>& Materials;
+  std::pmr::memory_resource* scratch;
+  std::pmr::memory_resource* output;
+
+  std::pmr::vector<float> positions;
+  std::pmr::vector<float> texCoords;
+  std::pmr::vector<float> normals;
+
+  InterleavedObject current;
+  std::unordered_map<std::string, size_t> batchIndex; //material name to batch of current object
+  InterleavedBatch* batch = nullptr; //batch of current material, faces are appended to it
+  std::string mtl = "";
+  bool materialsOk = true; //false once an mtllib file was missing or malformed
+
+  InterleavedBuilder(std::vector<InterleavedObject>& Objects, std::vector<Material>& Materials, std::pmr::memory_resource* scratch, std::pmr::memory_resource* output)
+    : Objects(Objects), Materials(Materials), scratch(scratch), output(output), positions(scratch), texCoords(scratch), normals(scratch){}
+
+  void onVertex(float x, float y, float z){ positions.insert(positions.end(), {x, y, z}); }
+  void onTexCoord(float u, float v, float){ texCoords.insert(texCoords.end(), {u, v}); }
+  void onNormal(float x, float y, float z){ normals.insert(normals.end(), {x, y, z}); }
+
+  void selectBatch(){
+    auto it = batchIndex.find(mtl);
+    if(it == batchIndex.end()){
+      it = batchIndex.emplace(mtl, current.batches.size()).first;
+      current.batches.push_back(InterleavedBatch(mtl, output));
     }
-    //------------------
-    else if(op == "usemtl"){
-      if (!Positions.empty()){
-        Meshes.push_back(Mesh(Positions, mtl, vcount, vtcount, vncount)); 
-        
-        Positions.clear();
+    batch = &current.batches[it->second];
+  }
+
+  //missing or out of range parts get the defaults Renderer uses
+  void addCorner(float* out, const Corner& c){
+    if(c.v && c.v <= positions.size() / 3) std::copy_n(&positions[(c.v - 1) * 3], 3, out);
+    else std::fill_n(out, 3, 0.0f);
+    if(c.vn && c.vn <= normals.size() / 3){
+      std::copy_n(&normals[(c.vn - 1) * 3], 3, out + 3);
+      batch->state |= 2;
+    }
+    else{ out[3] = 0.0f; out[4] = 1.0f; out[5] = 0.0f; }
+    if(c.vt && c.vt <= texCoords.size() / 2){
+      std::copy_n(&texCoords[(c.vt - 1) * 2], 2, out + 6);
+      batch->state |= 1;
+    }
+    else{ out[6] = 0.0f; out[7] = 1.0f; }
+  }
+
+  //triangle is assembled on stack and appended, so batch memory is written once
+  void onFace(const Corner* corners, size_t n){
+    if(!batch) selectBatch();
+    float triangle[24];
+    for(size_t i=2; i<n; i++){
+      addCorner(triangle, corners[0]);
+      addCorner(triangle + 8, corners[i-1]);
+      addCorner(triangle + 16, corners[i]);
+      batch->vertices.insert(batch->vertices.end(), triangle, triangle + 24);
+    }
+  }
+
+  void onMtllib(std::string_view path){
+    materialsOk &= loadMtl(std::string(path), Materials, scratch);
+  }
+  void onUseMtl(std::string_view name){
+    mtl = name;
+    batch = nullptr;
+  }
+  void onObject(std::string_view name){
+    finish();
+    current.name = name;
+  }
+
+  //pushes current object if it has any triangles
+  void finish(){
+    if(!current.batches.empty())
+      Objects.push_back(std::move(current));
+    current = InterleavedObject();
+    batchIndex.clear();
+    batch = nullptr;
+  }
+};
+
+//single pass alternative to loadObject + Renderer::LoadObject: faces are expanded
+//to GPU vertex layout while parsing, grouped per material. Always parses the
+//mapped file on one thread, options.threads and options.useCache are ignored.
+bool loadInterleaved(std::vector<InterleavedObject>& Objects, std::vector<Material>& Materials, std::string path, const LoadOptions& options = LoadOptions()){
+  if(path.size() < 4 || path.substr(path.size()-4,4) != ".obj") return false;
+  MappedFile file(path);
+  if(!file.isOpen()) return false;
+
+  if(Materials.empty()) 
+    Materials.push_back(Material("Default"));
+
+  std::pmr::monotonic_buffer_resource arena(std::pmr::new_delete_resource());
+  InterleavedBuilder b(Objects, Materials, options.scratch ? options.scratch : &arena, options.output ? options.output : std::pmr::get_default_resource());
+  ObjReader<InterleavedBuilder> r(b, b.scratch);
+  if(!parseBuffer(r, file.data, file.data + file.size)) return false;
+  b.finish();
+  return b.materialsOk;
+}
+
+//------------------ binary sidecar cache
+//Layout: CacheHeader, object/mesh/material/mtllib tables, then every array and string
+//64-byte aligned. Offsets are from file start, so a mapped file is used in place.
+
+struct CacheRange{
+  uint64_t offset;
+  uint64_t count; //elements
+};
+
+struct CacheHeader{
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint64_t sourceSize;
+  int64_t sourceTime;
+  uint64_t sourceHash;
+  uint64_t objectCount, meshCount, materialCount, mtllibCount;
+  uint64_t objects, meshes, materials, mtllibs; //table offsets
+};
+
+struct CacheObject{
+  CacheRange name, vertices, texCoords, normals;
+  uint64_t firstMesh, meshCount;
+};
+
+struct CacheMesh{
+  CacheRange mtl, positions, texPositions, normPositions;
+};
+
+struct CacheMaterial{
+  CacheRange name, DiffuseMap, AmbientMap, SpecularMap, BumpMap;
+  float ambient[3], diffuse[3], specular[3], emission[3];
+  float sExponent, opacity;
+};
+
+//material file cached materials came from, checked the same way as the source
+struct CacheMtllib{
+  CacheRange path;
+  uint64_t size;
+  int64_t time;
+  uint64_t hash;
+};
+
+const char cacheMagic[8] = {'O','B','J','L','B','I','N','\0'};
+const uint32_t cacheVersion = 2;
+
+inline uint64_t hashMix(uint64_t h, uint64_t v){
+  h ^= v * 0x9E3779B97F4A7C15ULL;
+  h = (h << 31) | (h >> 33);
+  return h * 0xBF58476D1CE4E5B9ULL;
+}
+
+uint64_t hashBytes(const char* data, size_t size, uint64_t h){
+  size_t i = 0;
+  for(; i + 8 <= size; i += 8){
+    uint64_t v;
+    std::memcpy(&v, data + i, 8);
+    h = hashMix(h, v);
+  }
+  uint64_t tail = 0;
+  std::memcpy(&tail, data + i, size - i);
+  return hashMix(h, tail ^ size);
+}
+
+//content hash over 64 evenly spread 16 KiB blocks (whole file if smaller), so
+//checking a multi-GB source stays in the millisecond range
+uint64_t sourceHash(const MappedFile& file){
+  const size_t block = 16 * 1024, blocks = 64;
+  if(file.size <= block * blocks)
+    return hashBytes(file.data, file.size, 0);
+  uint64_t h = 0;
+  for(size_t i=0; i<blocks; i++){
+    size_t at = (file.size - block) / (blocks - 1) * i;
+    h = hashBytes(file.data + at, block, h);
+  }
+  return h;
+}
+
+//size, mtime and content hash of path, false if it can't be read
+bool fileKey(const std::string& path, uint64_t& size, int64_t& time, uint64_t& hash){
+  std::error_code ec;
+  size = std::filesystem::file_size(path, ec);
+  if(ec) return false;
+  time = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+  if(ec) return false;
+  MappedFile file(path);
+  if(!file.isOpen()) return false;
+  hash = sourceHash(file);
+  return true;
+}
+
+bool sourceKey(const std::string& path, CacheHeader& key){
+  return fileKey(path, key.sourceSize, key.sourceTime, key.sourceHash);
+}
+
+//mmaped sidecar, arrays and strings are used in place
+struct ModelCache{
+  MappedFile file;
+  const CacheHeader* header = nullptr;
+
+  //valid only if cachePath matches size, mtime and content hash of sourcePath and
+  //of every mtllib file its materials came from
+  ModelCache(const std::string& cachePath, const std::string& sourcePath) : file(cachePath){
+    if(!file.data || file.size < sizeof(CacheHeader)) return;
+    const CacheHeader* h = reinterpret_cast<const CacheHeader*>(file.data);
+    if(std::memcmp(h->magic, cacheMagic, 8) != 0 || h->version != cacheVersion || h->headerSize != sizeof(CacheHeader))
+      return;
+    CacheHeader key;
+    if(!sourceKey(sourcePath, key) || key.sourceSize != h->sourceSize || key.sourceTime != h->sourceTime || key.sourceHash != h->sourceHash)
+      return;
+    if(!fits(h->objects, h->objectCount * sizeof(CacheObject)) || !fits(h->meshes, h->meshCount * sizeof(CacheMesh)) || !fits(h->materials, h->materialCount * sizeof(CacheMaterial)) || !fits(h->mtllibs, h->mtllibCount * sizeof(CacheMtllib)))
+      return;
+    header = h;
+    for(size_t i=0; i<header->mtllibCount; i++){
+      const CacheMtllib& m = mtllib(i);
+      CacheMtllib current{};
+      if(!fits(m.path, 1) || !fileKey(std::string(string(m.path)), current.size, current.time, current.hash) ||
+         current.size != m.size || current.time != m.time || current.hash != m.hash){
+        header = nullptr;
+        return;
       }
-      mtl = tokens[1];
     }
-    //------------------
-    else if(op == "o"){
-      if(firstObj){
-        objName = tokens[1];
-        firstObj=false;
+    for(size_t i=0; i<header->objectCount; i++){
+      const CacheObject& o = object(i);
+      if(!fits(o.name, 1) || !fits(o.vertices, sizeof(float)) || !fits(o.texCoords, sizeof(float)) || !fits(o.normals, sizeof(float)) || o.firstMesh + o.meshCount > header->meshCount){
+        header = nullptr;
+        return;
       }
-      else{
-        Meshes.push_back(Mesh(Positions, mtl, vcount, vtcount, vncount)); 
-        
-        Objects.push_back(Object(objName, GeometryV, TextureV, NormalV, Meshes));
-      
-        Positions.clear();
-        vcount += GeometryV.size();
-        vtcount += TextureV.size();
-        vncount += NormalV.size();
-        GeometryV.clear();
-        TextureV.clear();
-        NormalV.clear();
-        Meshes.clear();
-
-        objName = tokens[1];
+    }
+    for(size_t i=0; i<header->meshCount; i++){
+      const CacheMesh& m = mesh(i);
+      if(!fits(m.mtl, 1) || !fits(m.positions, 4) || !fits(m.texPositions, 4) || !fits(m.normPositions, 4)){
+        header = nullptr;
+        return;
       }
     }
-    //------------------
-    else if(op == "g"){
-      Meshes.push_back(Mesh(Positions, mtl, vcount, vtcount, vncount)); 
-        
-      Positions.clear();
+    for(size_t i=0; i<header->materialCount; i++){
+      const CacheMaterial& m = material(i);
+      if(!fits(m.name, 1) || !fits(m.DiffuseMap, 1) || !fits(m.AmbientMap, 1) || !fits(m.SpecularMap, 1) || !fits(m.BumpMap, 1)){
+        header = nullptr;
+        return;
+      }
     }
-    li++;
-  }   
-  
-  if(!Positions.empty()){
-    Meshes.push_back(Mesh(Positions, mtl, vcount, vtcount, vncount)); 
-    Objects.push_back(Object(objName, GeometryV, TextureV, NormalV, Meshes));
   }
 
-  return true;
+  bool fits(uint64_t offset, uint64_t bytes) const{
+    return offset <= file.size && bytes <= file.size - offset;
+  }
+  bool fits(CacheRange r, uint64_t elemSize) const{
+    return r.count <= file.size / elemSize && fits(r.offset, r.count * elemSize);
+  }
+
+  bool isValid() const{ return header != nullptr; }
+
+  const CacheObject& object(size_t i) const{ return reinterpret_cast<const CacheObject*>(file.data + header->objects)[i]; }
+  const CacheMesh& mesh(size_t i) const{ return reinterpret_cast<const CacheMesh*>(file.data + header->meshes)[i]; }
+  const CacheMaterial& material(size_t i) const{ return reinterpret_cast<const CacheMaterial*>(file.data + header->materials)[i]; }
+  const CacheMtllib& mtllib(size_t i) const{ return reinterpret_cast<const CacheMtllib*>(file.data + header->mtllibs)[i]; }
+
+  template<typename T>
+  const T* data(CacheRange r) const{ return reinterpret_cast<const T*>(file.data + r.offset); }
+  std::string_view string(CacheRange r) const{ return std::string_view(file.data + r.offset, r.count); }
+};
+
+//appends cached materials the same way a parse would
+void loadCachedMaterials(const ModelCache& cache, std::vector<Material>& Materials){
+  if(Materials.empty()) 
+    Materials.push_back(Material("Default"));
+
+  for(size_t i=0; i<cache.header->materialCount; i++){
+    const CacheMaterial& c = cache.material(i);
+    Material m{std::string(cache.string(c.name))};
+    m.DiffuseMap = cache.string(c.DiffuseMap);
+    m.AmbientMap = cache.string(c.AmbientMap);
+    m.SpecularMap = cache.string(c.SpecularMap);
+    m.BumpMap = cache.string(c.BumpMap);
+    std::copy(c.ambient, c.ambient + 3, m.ambient);
+    std::copy(c.diffuse, c.diffuse + 3, m.diffuse);
+    std::copy(c.specular, c.specular + 3, m.specular);
+    std::copy(c.emission, c.emission + 3, m.emission);
+    m.sExponent = c.sExponent;
+    m.opacity = c.opacity;
+    Materials.push_back(m);
+  }
+}
+
+//appends cached objects and materials the same way a parse would, arrays are copied
+void loadFromCache(const ModelCache& cache, std::vector<Object>& Objects, std::vector<Material>& Materials, std::pmr::memory_resource* output = std::pmr::get_default_resource()){
+  loadCachedMaterials(cache, Materials);
+
+  Objects.reserve(Objects.size() + cache.header->objectCount);
+  for(size_t i=0; i<cache.header->objectCount; i++){
+    const CacheObject& c = cache.object(i);
+    Object o(std::string(cache.string(c.name)), {}, {}, {}, {}, output);
+    o.vertices.assign(cache.data<float>(c.vertices), cache.data<float>(c.vertices) + c.vertices.count);
+    o.texCoords.assign(cache.data<float>(c.texCoords), cache.data<float>(c.texCoords) + c.texCoords.count);
+    o.normals.assign(cache.data<float>(c.normals), cache.data<float>(c.normals) + c.normals.count);
+    o.meshes.reserve(c.meshCount);
+    for(size_t j=c.firstMesh; j<c.firstMesh + c.meshCount; j++){
+      const CacheMesh& cm = cache.mesh(j);
+      Mesh m(std::vector<Index>(), std::string(cache.string(cm.mtl)), 0, 0, 0, output);
+      m.positions.assign(cache.data<unsigned int>(cm.positions), cache.data<unsigned int>(cm.positions) + cm.positions.count);
+      m.texPositions.assign(cache.data<unsigned int>(cm.texPositions), cache.data<unsigned int>(cm.texPositions) + cm.texPositions.count);
+      m.normPositions.assign(cache.data<unsigned int>(cm.normPositions), cache.data<unsigned int>(cm.normPositions) + cm.normPositions.count);
+      o.meshes.push_back(std::move(m));
+    }
+    Objects.push_back(std::move(o));
+  }
+}
+
+//------------------ zero-copy views
+//arrays of a mesh or object without owning them, same layout as Mesh and Object
+struct MeshView{
+  std::string_view mtl;
+  std::span<const unsigned int> positions;
+  std::span<const unsigned int> texPositions;
+  std::span<const unsigned int> normPositions;
+};
+
+struct ObjectView{
+  std::string_view name;
+  std::span<const float> vertices;
+  std::span<const float> texCoords;
+  std::span<const float> normals;
+  std::vector<MeshView> meshes;
+};
+
+//objects of one loadObjectView call. Views point into the mapped sidecar, or into
+//parsed objects when there was none; copies share them, so views stay valid as
+//long as any copy lives
+struct ModelView{
+  std::shared_ptr<const ModelCache> cache;
+  std::shared_ptr<const std::vector<Object>> parsed;
+  std::vector<ObjectView> Objects;
+
+  bool isMapped() const{ return cache != nullptr; }
+};
+
+ObjectView viewObject(const ModelCache& cache, size_t i){
+  const CacheObject& c = cache.object(i);
+  ObjectView o{cache.string(c.name), {cache.data<float>(c.vertices), c.vertices.count},
+    {cache.data<float>(c.texCoords), c.texCoords.count}, {cache.data<float>(c.normals), c.normals.count}, {}};
+  o.meshes.reserve(c.meshCount);
+  for(size_t j=c.firstMesh; j<c.firstMesh + c.meshCount; j++){
+    const CacheMesh& cm = cache.mesh(j);
+    o.meshes.push_back({cache.string(cm.mtl), {cache.data<unsigned int>(cm.positions), cm.positions.count},
+      {cache.data<unsigned int>(cm.texPositions), cm.texPositions.count}, {cache.data<unsigned int>(cm.normPositions), cm.normPositions.count}});
+  }
+  return o;
+}
+
+ObjectView viewObject(const Object& obj){
+  ObjectView o{obj.name, obj.vertices, obj.texCoords, obj.normals, {}};
+  o.meshes.reserve(obj.meshes.size());
+  for(const Mesh& m : obj.meshes)
+    o.meshes.push_back({m.mtl, m.positions, m.texPositions, m.normPositions});
+  return o;
+}
+
+//writes Objects[firstObject..] and Materials[firstMaterial..] next to source, with keys
+//of mtllibs the materials came from, through a temporary file so readers never see a
+//partial sidecar
+bool writeCache(const std::string& cachePath, const std::string& sourcePath, const std::vector<Object>& Objects, size_t firstObject, const std::vector<Material>& Materials, size_t firstMaterial, const std::vector<std::string>& mtllibs){
+  CacheHeader h{};
+  if(!sourceKey(sourcePath, h)) return false;
+  std::memcpy(h.magic, cacheMagic, 8);
+  h.version = cacheVersion;
+  h.headerSize = sizeof(CacheHeader);
+  h.objectCount = Objects.size() - firstObject;
+  h.materialCount = Materials.size() - firstMaterial;
+  h.mtllibCount = mtllibs.size();
+  for(size_t i=firstObject; i<Objects.size(); i++)
+    h.meshCount += Objects[i].meshes.size();
+  h.objects = sizeof(CacheHeader);
+  h.meshes = h.objects + h.objectCount * sizeof(CacheObject);
+  h.materials = h.meshes + h.meshCount * sizeof(CacheMesh);
+  h.mtllibs = h.materials + h.materialCount * sizeof(CacheMaterial);
+
+  std::vector<std::pair<const void*, uint64_t>> blobs; //written in order after tables
+  uint64_t end = h.mtllibs + h.mtllibCount * sizeof(CacheMtllib);
+  auto add = [&](const void* data, uint64_t count, uint64_t elemSize){
+    end = (end + 63) & ~uint64_t(63);
+    CacheRange r{end, count};
+    blobs.push_back({data, count * elemSize});
+    end += count * elemSize;
+    return r;
+  };
+
+  std::vector<CacheObject> objects;
+  std::vector<CacheMesh> meshes;
+  std::vector<CacheMaterial> materials;
+  for(size_t i=firstObject; i<Objects.size(); i++){
+    const Object& o = Objects[i];
+    objects.push_back({add(o.name.data(), o.name.size(), 1), add(o.vertices.data(), o.vertices.size(), sizeof(float)),
+      add(o.texCoords.data(), o.texCoords.size(), sizeof(float)), add(o.normals.data(), o.normals.size(), sizeof(float)),
+      meshes.size(), o.meshes.size()});
+    for(const Mesh& m : o.meshes)
+      meshes.push_back({add(m.mtl.data(), m.mtl.size(), 1), add(m.positions.data(), m.positions.size(), 4),
+        add(m.texPositions.data(), m.texPositions.size(), 4), add(m.normPositions.data(), m.normPositions.size(), 4)});
+  }
+  for(size_t i=firstMaterial; i<Materials.size(); i++){
+    const Material& m = Materials[i];
+    CacheMaterial c{};
+    c.name = add(m.name.data(), m.name.size(), 1);
+    c.DiffuseMap = add(m.DiffuseMap.data(), m.DiffuseMap.size(), 1);
+    c.AmbientMap = add(m.AmbientMap.data(), m.AmbientMap.size(), 1);
+    c.SpecularMap = add(m.SpecularMap.data(), m.SpecularMap.size(), 1);
+    c.BumpMap = add(m.BumpMap.data(), m.BumpMap.size(), 1);
+    std::copy(m.ambient, m.ambient + 3, c.ambient);
+    std::copy(m.diffuse, m.diffuse + 3, c.diffuse);
+    std::copy(m.specular, m.specular + 3, c.specular);
+    std::copy(m.emission, m.emission + 3, c.emission);
+    c.sExponent = m.sExponent;
+    c.opacity = m.opacity;
+    materials.push_back(c);
+  }
+  std::vector<CacheMtllib> mtllibKeys;
+  for(const std::string& path : mtllibs){
+    CacheMtllib c{};
+    c.path = add(path.data(), path.size(), 1);
+    if(!fileKey(path, c.size, c.time, c.hash)) return false;
+    mtllibKeys.push_back(c);
+  }
+
+  std::string tmp = cachePath + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if(!out.is_open()) return false;
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(objects.data()), objects.size() * sizeof(CacheObject));
+    out.write(reinterpret_cast<const char*>(meshes.data()), meshes.size() * sizeof(CacheMesh));
+    out.write(reinterpret_cast<const char*>(materials.data()), materials.size() * sizeof(CacheMaterial));
+    out.write(reinterpret_cast<const char*>(mtllibKeys.data()), mtllibKeys.size() * sizeof(CacheMtllib));
+    uint64_t pos = h.mtllibs + h.mtllibCount * sizeof(CacheMtllib);
+    const char zeros[64] = {};
+    for(const auto& b : blobs){
+      uint64_t aligned = (pos + 63) & ~uint64_t(63);
+      out.write(zeros, aligned - pos);
+      out.write(static_cast<const char*>(b.first), b.second);
+      pos = aligned + b.second;
+    }
+    if(!out) return false;
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, cachePath, ec);
+  return !ec;
+}
+
+//push parser for data that never exists as a whole file (pipes, decompressors).
+//Takes arbitrary chunks, buffers only the unfinished line. Meshes go to onMesh as
+//soon as o/g/usemtl closes them, objects are appended to Objects when o closes them.
+struct StreamParser{
+  std::vector<Object>& Objects;
+  std::vector<Material>& Materials;
+  //used when no scratch is given. Buffers freed when vectors regrow go back to the pool, and
+  //geometry is cleared at every o, so scratch stays at the largest object's size instead of
+  //growing with the whole stream
+  std::pmr::unsynchronized_pool_resource arena;
+  ObjectBuilder s;
+  ObjReader<ObjectBuilder> r;
+  std::string carry; //partial line from previous feed
+  bool failed = false;
+
+  StreamParser(std::vector<Object>& Objects, std::vector<Material>& Materials, std::pmr::memory_resource* scratch = nullptr, std::pmr::memory_resource* output = nullptr)
+    : Objects(Objects), Materials(Materials), arena(std::pmr::new_delete_resource()),
+      s(Objects, Materials, scratch ? scratch : &arena, output ? output : std::pmr::get_default_resource()), r(s, s.scratch){
+    if(Materials.empty()) 
+      Materials.push_back(Material("Default"));
+  }
+
+  void setMeshCallback(std::function<void(const Mesh&, const std::string&)> callback){
+    s.onMesh = callback;
+  }
+
+  //false once data was malformed, further feeds are ignored
+  bool feed(const char* data, size_t size){
+    if(failed) return false;
+    const char* end = data + size;
+
+    if(!carry.empty()){
+      const char* eol = findByte(data, end, '\n', end);
+      carry.append(data, eol);
+      if(eol == end) return true;
+      r.limit = carry.data() + carry.size();
+      failed = !parseLine(r, carry.data(), r.limit);
+      carry.clear();
+      if(failed) return false;
+      data = eol + 1;
+    }
+
+    const char* lastLine = end; //start of unfinished line
+    while(lastLine != data && lastLine[-1] != '\n') lastLine--;
+    if(lastLine != data && !parseBuffer(r, data, lastLine)){
+      failed = true;
+      return false;
+    }
+    carry.assign(lastLine, end);
+    return true;
+  }
+
+  //parses last line without newline and closes current object, false also when
+  //an mtllib file was missing or malformed
+  bool finish(){
+    if(failed) return false;
+    if(!carry.empty()){
+      r.limit = carry.data() + carry.size();
+      failed = !parseLine(r, carry.data(), r.limit);
+      carry.clear();
+      if(failed) return false;
+    }
+    s.finish();
+    return s.materialsOk;
+  }
+};
+
+//loads .obj data from any stream, e.g. std::cin fed by a pipe
+bool loadObject(std::vector<Object>& Objects, std::vector<Material>& Materials, std::istream& in){
+  StreamParser parser(Objects, Materials);
+  std::vector<char> buf(1 << 16);
+  while(in){
+    in.read(buf.data(), buf.size());
+    if(!parser.feed(buf.data(), in.gcount())) return false;
+  }
+  return parser.finish();
+}
+
+bool loadObject(std::vector<Object>& Objects, std::vector<Material>& Materials, std::string path, const LoadOptions& options = LoadOptions()){
+  if(path.substr(path.size()-4,4) != ".obj") return false;
+
+  std::string cachePath = path + ".bin";
+  if(options.useCache){
+    ModelCache cache(cachePath, path);
+    if(cache.isValid()){
+      loadFromCache(cache, Objects, Materials, options.output ? options.output : std::pmr::get_default_resource());
+      return true;
+    }
+  }
+  size_t firstObject = Objects.size();
+  size_t firstMaterial = Materials.empty() ? 1 : Materials.size(); //Default material is implied
+
+  unsigned int threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+  bool loaded;
+  std::vector<std::string> mtllibs;
+  if(options.mapFile || threads > 1)
+    loaded = loadObjectMapped(Objects, Materials, path, threads, options, mtllibs);
+  else
+    loaded = loadObjectText(Objects, Materials, path, options, mtllibs);
+
+  if(loaded && options.useCache && !writeCache(cachePath, path, Objects, firstObject, Materials, firstMaterial, mtllibs))
+    std::cout<<"Couldn't write cache "<<cachePath<<".\n";
+  return loaded;
+}
+
+//loadObject with useCache, but a valid sidecar is used in place instead of being copied
+//into Objects: model's views point into the mapping. Otherwise the file is parsed, the
+//sidecar written for next time and views point into the parsed objects. Replaces model.
+bool loadObjectView(ModelView& model, std::vector<Material>& Materials, std::string path, const LoadOptions& options = LoadOptions()){
+  model = ModelView();
+  if(path.substr(path.size()-4,4) != ".obj") return false;
+
+  auto cache = std::make_shared<const ModelCache>(path + ".bin", path);
+  if(cache->isValid()){
+    loadCachedMaterials(*cache, Materials);
+    model.Objects.reserve(cache->header->objectCount);
+    for(size_t i=0; i<cache->header->objectCount; i++)
+      model.Objects.push_back(viewObject(*cache, i));
+    model.cache = std::move(cache);
+    return true;
+  }
+
+  auto parsed = std::make_shared<std::vector<Object>>();
+  LoadOptions parse = options;
+  parse.useCache = true;
+  bool loaded = loadObject(*parsed, Materials, path, parse);
+  model.Objects.reserve(parsed->size());
+  for(const Object& o : *parsed)
+    model.Objects.push_back(viewObject(o));
+  model.parsed = std::move(parsed);
+  return loaded;
 }
 
 }//close namespace
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+namespace scene {
+
+constexpr int32_t null = -1;
+
+//leaf holds item box grown by tree margin, inner node holds union of its children
+struct Node{
+  glm::vec3 min, max;
+  int32_t parent = null; //next free node while node is in free list
+  int32_t child1 = null, child2 = null; //null - leaf
+  int32_t height = 0; //leaf - 0
+  uint32_t item = 0; //caller's index, e.g. into vector of Renderer::Model
+};
+
+//dynamic AABB tree (Box2D style): leaves go where they grow surface area least and
+//AVL rotations keep it balanced, so add/remove/update cost O(log n) and queries visit
+//only nodes overlapping the region
+struct Tree{
+  std::vector<Node> nodes;
+  int32_t root = null;
+  int32_t freeList = null;
+  size_t leaves = 0;
+  float margin = 0.0f; //leaf boxes are grown by it, update inside grown box costs nothing
+};
+
+struct CullStats{
+  size_t nodesTested = 0, itemsVisible = 0;
+};
+
+//------------------ tree maintenance
+
+inline bool isLeaf(const Node& n){ return n.child1 == null; }
+
+inline float area(const glm::vec3& min, const glm::vec3& max){
+  glm::vec3 d = max - min;
+  return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+inline float unionArea(const Node& a, const Node& b){
+  return area(glm::min(a.min, b.min), glm::max(a.max, b.max));
+}
+
+int32_t allocateNode(Tree& tree){
+  if(tree.freeList == null){
+    tree.nodes.push_back(Node());
+    return static_cast<int32_t>(tree.nodes.size()) - 1;
+  }
+  int32_t id = tree.freeList;
+  tree.freeList = tree.nodes[id].parent;
+  tree.nodes[id] = Node();
+  return id;
+}
+
+void freeNode(Tree& tree, int32_t id){
+  tree.nodes[id].parent = tree.freeList;
+  tree.nodes[id].height = -1;
+  tree.freeList = id;
+}
+
+//box and height of inner node from its children
+void refit(Tree& tree, int32_t id){
+  Node& n = tree.nodes[id];
+  const Node& a = tree.nodes[n.child1];
+  const Node& b = tree.nodes[n.child2];
+  n.min = glm::min(a.min, b.min);
+  n.max = glm::max(a.max, b.max);
+  n.height = 1 + std::max(a.height, b.height);
+}
+
+//lifts taller grandchild subtree one level when children heights differ by more than 1,
+//returns node now at id's place
+int32_t balance(Tree& tree, int32_t iA){
+  std::vector<Node>& n = tree.nodes;
+  if(isLeaf(n[iA]) || n[iA].height < 2) return iA;
+  int32_t iB = n[iA].child1, iC = n[iA].child2;
+  int diff = n[iC].height - n[iB].height;
+  if(diff >= -1 && diff <= 1) return iA;
+
+  //iUp replaces iA, iA keeps iStay and the shorter child of iUp
+  bool right = diff > 1;
+  int32_t iUp = right ? iC : iB;
+  int32_t iF = n[iUp].child1, iG = n[iUp].child2;
+  n[iUp].child1 = iA;
+  n[iUp].parent = n[iA].parent;
+  n[iA].parent = iUp;
+  if(n[iUp].parent == null) tree.root = iUp;
+  else if(n[n[iUp].parent].child1 == iA) n[n[iUp].parent].child1 = iUp;
+  else n[n[iUp].parent].child2 = iUp;
+
+  int32_t taller = n[iF].height > n[iG].height ? iF : iG;
+  int32_t shorter = taller == iF ? iG : iF;
+  n[iUp].child2 = taller;
+  if(right) n[iA].child2 = shorter;
+  else n[iA].child1 = shorter;
+  n[shorter].parent = iA;
+  refit(tree, iA);
+  refit(tree, iUp);
+  return iUp;
+}
+
+//refits and balances every node from id up to root
+void fixUpwards(Tree& tree, int32_t id){
+  while(id != null){
+    id = balance(tree, id);
+    refit(tree, id);
+    id = tree.nodes[id].parent;
+  }
+}
+
+void insertLeaf(Tree& tree, int32_t leaf){
+  std::vector<Node>& n = tree.nodes;
+  if(tree.root == null){
+    tree.root = leaf;
+    n[leaf].parent = null;
+    return;
+  }
+  //descend while pushing leaf further down is cheaper than making it sibling here
+  int32_t id = tree.root;
+  while(!isLeaf(n[id])){
+    float combined = unionArea(n[id], n[leaf]);
+    float cost = 2.0f * combined;
+    float inherited = 2.0f * (combined - area(n[id].min, n[id].max)); //paid by every ancestor below
+    auto childCost = [&](int32_t c){
+      float grown = unionArea(n[c], n[leaf]);
+      return (isLeaf(n[c]) ? grown : grown - area(n[c].min, n[c].max)) + inherited;
+    };
+    float cost1 = childCost(n[id].child1), cost2 = childCost(n[id].child2);
+    if(cost < cost1 && cost < cost2) break;
+    id = cost1 < cost2 ? n[id].child1 : n[id].child2;
+  }
+
+  int32_t sibling = id;
+  int32_t oldParent = n[sibling].parent;
+  int32_t parent = allocateNode(tree); //may reallocate nodes, n is a reference to the vector
+  n[parent].parent = oldParent;
+  n[parent].child1 = sibling;
+  n[parent].child2 = leaf;
+  n[sibling].parent = parent;
+  n[leaf].parent = parent;
+  if(oldParent == null) tree.root = parent;
+  else if(n[oldParent].child1 == sibling) n[oldParent].child1 = parent;
+  else n[oldParent].child2 = parent;
+  fixUpwards(tree, parent);
+}
+
+void removeLeaf(Tree& tree, int32_t leaf){
+  std::vector<Node>& n = tree.nodes;
+  if(leaf == tree.root){
+    tree.root = null;
+    return;
+  }
+  int32_t parent = n[leaf].parent;
+  int32_t grandParent = n[parent].parent;
+  int32_t sibling = n[parent].child1 == leaf ? n[parent].child2 : n[parent].child1;
+  freeNode(tree, parent);
+  n[sibling].parent = grandParent;
+  if(grandParent == null){
+    tree.root = sibling;
+    return;
+  }
+  if(n[grandParent].child1 == parent) n[grandParent].child1 = sibling;
+  else n[grandParent].child2 = sibling;
+  fixUpwards(tree, grandParent);
+}
+
+//------------------ user functions
+
+//adds item with box, returns its proxy for update and remove
+int32_t insert(Tree& tree, const glm::vec3& min, const glm::vec3& max, uint32_t item){
+  int32_t leaf = allocateNode(tree);
+  tree.nodes[leaf].min = min - glm::vec3(tree.margin);
+  tree.nodes[leaf].max = max + glm::vec3(tree.margin);
+  tree.nodes[leaf].item = item;
+  insertLeaf(tree, leaf);
+  tree.leaves++;
+  return leaf;
+}
+
+void remove(Tree& tree, int32_t proxy){
+  removeLeaf(tree, proxy);
+  freeNode(tree, proxy);
+  tree.leaves--;
+}
+
+//moves proxy to new box, returns false when it still fits grown box and tree is untouched
+bool update(Tree& tree, int32_t proxy, const glm::vec3& min, const glm::vec3& max){
+  Node& leaf = tree.nodes[proxy];
+  if(glm::all(glm::lessThanEqual(leaf.min, min)) && glm::all(glm::lessThanEqual(max, leaf.max))) return false;
+  removeLeaf(tree, proxy);
+  leaf.min = min - glm::vec3(tree.margin);
+  leaf.max = max + glm::vec3(tree.margin);
+  insertLeaf(tree, proxy);
+  return true;
+}
+
+//calls visit(item) for every item whose box overlaps [min, max]
+template<class Visitor>
+void query(const Tree& tree, const glm::vec3& min, const glm::vec3& max, Visitor&& visit){
+  if(tree.root == null) return;
+  int32_t stack[64];
+  int top = 0;
+  stack[top++] = tree.root;
+  while(top > 0){
+    const Node& n = tree.nodes[stack[--top]];
+    if(glm::any(glm::lessThan(n.max, min)) || glm::any(glm::lessThan(max, n.min))) continue;
+    if(isLeaf(n)) visit(n.item);
+    else{
+      stack[top++] = n.child2;
+      stack[top++] = n.child1;
+    }
+  }
+}
+
+//calls visit(item) for every item whose box is not outside one of planes (left, right,
+//bottom, top, near, far; inside when dot(plane, (p, 1)) >= 0, as in Renderer::View).
+//Planes a node is fully inside are not tested for its subtree, subtrees inside all of
+//them are visited without tests, so cost follows visible items rather than all items.
+template<class Visitor>
+CullStats cull(const Tree& tree, const glm::vec4* planes, Visitor&& visit){
+  CullStats stats;
+  if(tree.root == null) return stats;
+  struct Entry{ int32_t node; uint32_t mask; }; //mask - planes still to test
+  Entry stack[64];
+  int top = 0;
+  stack[top++] = {tree.root, 0x3F};
+  while(top > 0){
+    Entry e = stack[--top];
+    const Node& n = tree.nodes[e.node];
+    if(e.mask){
+      stats.nodesTested++;
+      bool outside = false;
+      for(int k=0; k<6 && !outside; k++){
+        if(!(e.mask & (1u << k))) continue;
+        const glm::vec4& p = planes[k];
+        glm::vec3 far(p.x >= 0.0f ? n.max.x : n.min.x, p.y >= 0.0f ? n.max.y : n.min.y, p.z >= 0.0f ? n.max.z : n.min.z);
+        glm::vec3 near(p.x >= 0.0f ? n.min.x : n.max.x, p.y >= 0.0f ? n.min.y : n.max.y, p.z >= 0.0f ? n.min.z : n.max.z);
+        if(glm::dot(glm::vec3(p), far) + p.w < 0.0f) outside = true;
+        else if(glm::dot(glm::vec3(p), near) + p.w >= 0.0f) e.mask &= ~(1u << k);
+      }
+      if(outside) continue;
+    }
+    if(isLeaf(n)){
+      stats.itemsVisible++;
+      visit(n.item);
+    }
+    else{
+      stack[top++] = {n.child2, e.mask};
+      stack[top++] = {n.child1, e.mask};
+    }
+  }
+  return stats;
+}
+
+}//close namespace
@@ -6,17 +6,37 @@ layout (location = 2) in vec2 aTexCoords;
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+flat out int MaterialId;
+flat out int State;
+flat out int Layer; //diffuse map is diffuseM
 
 uniform mat4 view;
 uniform mat4 projection;
 uniform mat4 model;
+uniform mat4 dequantize; //identity for float vertices
+uniform bool octNormals;
+uniform int materialId;
+uniform int state;
+
+vec3 octDecode(vec2 e){
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
 
 void main(){
-  vec4 worldPos = model * vec4(aPos, 1.0);
-  FragPos = vec3(model * vec4(aPos, 1.0));
+  vec4 localPos = dequantize * vec4(aPos, 1.0);
+  vec4 worldPos = model * localPos;
+  FragPos = vec3(worldPos);
   TexCoords = aTexCoords;
+  MaterialId = materialId;
+  State = state;
+  Layer = -1;
 
-  Normal = mat3(transpose(inverse(model))) * aNormal; 
+  vec3 normal = octNormals ? octDecode(aNormal.xy) : aNormal;
+  Normal = mat3(transpose(inverse(model))) * normal; 
 
   gl_Position = projection * view * worldPos;
 } 
@@ -0,0 +1,54 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : require
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+flat out int MaterialId;
+flat out int State;
+flat out int Layer;
+
+//Renderer::GpuDraw, one per command of glMultiDrawElementsIndirect
+struct DrawData {
+  mat4 dequantize; //identity for float vertices
+  int materialId;
+  int state;
+  int octNormals;
+  int layer; //layer in diffuseArray, -1 - diffuseM
+};
+
+layout(std430, binding = 1) readonly buffer DrawBlock {
+  DrawData draws[];
+};
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform mat4 model;
+uniform int drawOffset; //first command of current call, gl_DrawID starts at 0 in every call
+
+vec3 octDecode(vec2 e){
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+void main(){
+  DrawData draw = draws[drawOffset + gl_DrawIDARB];
+  vec4 localPos = draw.dequantize * vec4(aPos, 1.0);
+  vec4 worldPos = model * localPos;
+  FragPos = vec3(worldPos);
+  TexCoords = aTexCoords;
+  MaterialId = draw.materialId;
+  State = draw.state;
+  Layer = draw.layer;
+
+  vec3 normal = draw.octNormals != 0 ? octDecode(aNormal.xy) : aNormal;
+  Normal = mat3(transpose(inverse(model))) * normal; 
+
+  gl_Position = projection * view * worldPos;
+} 
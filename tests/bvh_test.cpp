@@ -0,0 +1,102 @@
+#include "bvh.h"
+#include "test.h"
+
+#include <random>
+#include <sstream>
+
+//random triangle soup in two objects, loaded through the parser like any OBJ
+std::vector<objLoader::Object> randomTriangles(uint32_t seed, int triangles){
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> center(-50.0f, 50.0f), offset(-2.0f, 2.0f);
+  std::ostringstream obj;
+  for(int o=0; o<2; o++){
+    obj << "o soup" << o << "\n";
+    for(int t=0; t<triangles / 2; t++){
+      float c[3] = {center(rng), center(rng), center(rng)};
+      for(int k=0; k<3; k++)
+        obj << "v " << c[0] + offset(rng) << " " << c[1] + offset(rng) << " " << c[2] + offset(rng) << "\n";
+      obj << "f -3 -2 -1\n";
+    }
+  }
+  std::istringstream in(obj.str());
+  std::vector<objLoader::Object> Objects;
+  std::vector<objLoader::Material> Materials;
+  CHECK(objLoader::loadObject(Objects, Materials, in));
+  return Objects;
+}
+
+//closest hit of every triangle in turn
+bvh::Hit bruteForce(const bvh::Bvh& b, const bvh::Ray& ray){
+  bvh::Hit hit;
+  hit.t = ray.tMax;
+  bvh::RayData r(ray);
+  for(uint32_t i=0; i<b.triangles.size(); i++)
+    if(bvh::intersectTriangle(b.triangles[i], r, hit.t, hit)) hit.triangle = i;
+  return hit;
+}
+
+//every triangle sits in exactly one leaf and inside the bounds of all nodes above it
+void checkTree(const bvh::Bvh& b){
+  std::vector<int> seen(b.triangles.size());
+  std::vector<uint32_t> stack = {0};
+  while(!stack.empty()){
+    const bvh::Node& n = b.nodes[stack.back()];
+    stack.pop_back();
+    if(n.count){
+      for(uint32_t i=n.leftFirst; i<n.leftFirst + n.count; i++){
+        seen[i]++;
+        const bvh::Triangle& t = b.triangles[i];
+        for(int k=0; k<3; k++)
+          for(float x : {t.v0[k], t.v0[k] + t.e1[k], t.v0[k] + t.e2[k]})
+            CHECK(x >= n.min[k] - 1e-4f && x <= n.max[k] + 1e-4f);
+      }
+      continue;
+    }
+    for(uint32_t c=n.leftFirst; c<n.leftFirst + 2; c++){
+      for(int k=0; k<3; k++)
+        CHECK(b.nodes[c].min[k] >= n.min[k] && b.nodes[c].max[k] <= n.max[k]);
+      stack.push_back(c);
+    }
+  }
+  for(int s : seen) CHECK(s == 1);
+}
+
+void testRays(unsigned int threads){
+  std::vector<objLoader::Object> Objects = randomTriangles(threads + 1, 4000);
+  bvh::BuildOptions options;
+  options.threads = threads;
+  bvh::Bvh b = bvh::build(std::span<const objLoader::Object>(Objects), options);
+  CHECK(b.triangles.size() == 4000);
+  checkTree(b);
+
+  //ids point back at source triangles
+  for(size_t i=0; i<b.ids.size(); i++){
+    const bvh::TriangleId& id = b.ids[i];
+    const objLoader::Object& object = Objects[id.object];
+    unsigned int v = object.meshes[id.mesh].positions[id.triangle * 3];
+    for(int k=0; k<3; k++) CHECK(b.triangles[i].v0[k] == object.vertices[v * 3 + k]);
+  }
+
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> U(-1.0f, 1.0f);
+  size_t hits = 0;
+  for(int i=0; i<2000; i++){
+    bvh::Ray ray;
+    ray.origin = glm::normalize(glm::vec3(U(rng), U(rng), U(rng))) * 150.0f;
+    ray.direction = glm::normalize(glm::vec3(U(rng), U(rng), U(rng)) * 40.0f - ray.origin);
+    if(i % 4 == 0) ray.tMax = 150.0f; //some rays end inside the soup
+    bvh::Hit expect = bruteForce(b, ray);
+    bvh::Hit hit = bvh::closestHit(b, ray);
+    CHECK(hit.hit() == expect.hit());
+    if(hit.hit() && expect.hit()) CHECK(std::abs(hit.t - expect.t) <= 1e-4f * std::max(1.0f, expect.t));
+    CHECK(bvh::anyHit(b, ray) == expect.hit());
+    hits += expect.hit();
+  }
+  CHECK(hits > 100); //rays do reach the soup
+}
+
+int main(){
+  testRays(1);
+  testRays(4);
+  return report("bvh");
+}
@@ -0,0 +1,542 @@
+#include "meshOptimizer.h"
+#include "test.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <thread>
+
+using namespace meshOptimizer;
+
+//------------------ test meshes
+
+//closed box of 6 faces, each an n x n grid with its own vertices (normal and uv seams
+//along box edges). Integer coordinates keep positions on shared edges bit equal,
+//face interiors are bumped so simplification has error to measure.
+IndexedMesh seamedBox(int n){
+  IndexedMesh mesh;
+  for(int face=0; face<6; face++){
+    int axis = face / 2;
+    float side = face % 2 ? float(n) : 0.0f;
+    unsigned int first = static_cast<unsigned int>(mesh.vertexCount());
+    for(int j=0; j<=n; j++)
+      for(int i=0; i<=n; i++){
+        float p[3];
+        p[axis] = side;
+        p[(axis + 1) % 3] = float(i);
+        p[(axis + 2) % 3] = float(j);
+        bool edge = i == 0 || j == 0 || i == n || j == n;
+        float bump = edge ? 0.0f : float((i * 7 + j * 13) % 3) * 0.25f;
+        p[axis] += face % 2 ? bump : -bump;
+        float normal[3] = {0.0f, 0.0f, 0.0f};
+        normal[axis] = face % 2 ? 1.0f : -1.0f;
+        float v[8] = {p[0], p[1], p[2], normal[0], normal[1], normal[2], float(i) / n, float(j) / n};
+        mesh.vertices.insert(mesh.vertices.end(), v, v + 8);
+      }
+    for(int j=0; j<n; j++)
+      for(int i=0; i<n; i++){
+        unsigned int a = first + j * (n + 1) + i, b = a + 1, c = a + n + 1, d = c + 1;
+        unsigned int quad[6] = {a, b, d, a, d, c};
+        if(face % 2 == 0) std::swap(quad[1], quad[2]), std::swap(quad[4], quad[5]);
+        mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+      }
+  }
+  mesh.state = 3;
+  return mesh;
+}
+
+//every corner gets its own vertex, as OBJ files with one vn per face end up after welding
+IndexedMesh flatShaded(const IndexedMesh& source){
+  IndexedMesh mesh;
+  for(size_t t=0; t<source.indices.size(); t+=3){
+    for(int k=0; k<3; k++){
+      const float* v = &source.vertices[source.indices[t + k] * 8];
+      mesh.vertices.insert(mesh.vertices.end(), v, v + 8);
+      mesh.vertices[mesh.vertices.size() - 2] = float(t % 7); //uv differs per face as well
+      mesh.indices.push_back(static_cast<unsigned int>(t + k));
+    }
+  }
+  mesh.state = 3;
+  return mesh;
+}
+
+//edges between positions used by one triangle only, i.e. cracks on a closed mesh
+size_t openEdges(const std::vector<unsigned int>& indices, const std::vector<float>& vertices){
+  std::map<std::array<float, 3>, unsigned int> ids;
+  std::vector<unsigned int> position(vertices.size() / 8);
+  for(size_t v=0; v<position.size(); v++)
+    position[v] = ids.emplace(std::array<float, 3>{vertices[v * 8], vertices[v * 8 + 1], vertices[v * 8 + 2]}, static_cast<unsigned int>(ids.size())).first->second;
+  std::map<std::pair<unsigned int, unsigned int>, int> uses;
+  for(size_t t=0; t<indices.size(); t+=3)
+    for(int k=0; k<3; k++){
+      unsigned int a = position[indices[t + k]], b = position[indices[t + (k + 1) % 3]];
+      if(a == b) continue;
+      uses[{std::min(a, b), std::max(a, b)}]++;
+    }
+  size_t open = 0;
+  for(const auto& edge : uses)
+    open += edge.second != 2;
+  return open;
+}
+
+//------------------ indexing
+
+//same ids as a map handing out indices in order of first use
+void testWelder(){
+  std::mt19937 rng(3);
+  VertexWelder welder(5000);
+  std::map<std::array<unsigned int, 3>, unsigned int> ids;
+  for(int i=0; i<5000; i++){
+    std::array<unsigned int, 3> t = {unsigned(rng() % 20), unsigned(rng() % 5), unsigned(rng() % 4)};
+    unsigned int expected = ids.emplace(t, static_cast<unsigned int>(ids.size())).first->second;
+    CHECK(welder.weld(t[0], t[1], t[2]) == expected);
+  }
+  CHECK(welder.triplets.size() == ids.size() * 3);
+}
+
+//two triangles sharing corners weld to 4 vertices, a third triangle points past every
+//array and gets zero position and Renderer's default normal and uv
+void testBuildIndexed(){
+  using objLoader::Vec3;
+  std::vector<Vec3> V = {Vec3(0, 0, 0), Vec3(1, 0, 0), Vec3(1, 1, 0), Vec3(0, 1, 0)};
+  std::vector<Vec3> T = {Vec3(0, 0, 0), Vec3(1, 0, 0), Vec3(1, 1, 0), Vec3(0, 1, 0)};
+  std::vector<Vec3> N = {Vec3(0, 0, 1), Vec3(0, 0, -1)};
+  objLoader::Mesh mesh(std::vector<objLoader::Index>(), "red", 0, 0, 0);
+  mesh.positions = {0, 1, 2, 0, 2, 3, 0, 1, 7};
+  mesh.texPositions = {0, 1, 2, 0, 2, 3, 0, 1, 9};
+  mesh.normPositions = {0, 0, 0, 0, 0, 1, 0, 0, 5};
+  objLoader::Object object("quad", V, T, N, {mesh});
+
+  IndexedMesh out = buildIndexed(object, object.meshes[0]);
+  CHECK(out.mtl == "red" && out.state == 3);
+  CHECK(out.vertexCount() == 5);
+  CHECK(out.indices == std::vector<unsigned int>({0, 1, 2, 0, 2, 3, 0, 1, 4}));
+  const float third[8] = {1, 1, 0, 0, 0, 1, 1, 1};
+  const float fourth[8] = {0, 1, 0, 0, 0, -1, 0, 1};
+  const float outside[8] = {0, 0, 0, 0, 1, 0, 0, 1};
+  CHECK(std::equal(third, third + 8, &out.vertices[2 * 8]));
+  CHECK(std::equal(fourth, fourth + 8, &out.vertices[3 * 8]));
+  CHECK(std::equal(outside, outside + 8, &out.vertices[4 * 8]));
+
+  //without vt and vn every corner gets the defaults and state says so
+  objLoader::Object plain("plain", V, {}, {}, {mesh});
+  out = buildIndexed(plain, plain.meshes[0]);
+  CHECK(out.state == 0);
+  for(size_t v=0; v<out.vertexCount(); v++)
+    CHECK(out.vertices[v * 8 + 4] == 1.0f && out.vertices[v * 8 + 7] == 1.0f);
+}
+
+//------------------ vertex cache
+
+//triangles as written, sorted, to compare orders of the same mesh
+std::vector<std::array<unsigned int, 3>> triangleSet(const std::vector<unsigned int>& indices){
+  std::vector<std::array<unsigned int, 3>> set;
+  for(size_t t=0; t<indices.size(); t+=3)
+    set.push_back({indices[t], indices[t + 1], indices[t + 2]});
+  std::sort(set.begin(), set.end());
+  return set;
+}
+
+void testAnalyzeVertexCache(){
+  std::vector<unsigned int> quad = {0, 1, 2, 0, 2, 3};
+  CacheStats stats = analyzeVertexCache(quad, 4);
+  CHECK(stats.triangles == 2 && stats.vertices == 4 && stats.misses == 4);
+  CHECK(stats.acmr() == 2.0f && stats.atvr() == 1.0f);
+  //with 2 entries 0 and 2 were pushed out by the time the second triangle needs them
+  CHECK(analyzeVertexCache(quad, 4, 2).misses == 6);
+  CHECK(analyzeVertexCache({}, 0).acmr() == 0.0f);
+}
+
+//shuffled box gets close to one miss per vertex, same triangles with the same winding
+void testTipsify(){
+  IndexedMesh mesh = seamedBox(16);
+  std::vector<std::array<unsigned int, 3>> triangles = triangleSet(mesh.indices);
+  std::vector<size_t> order(mesh.indices.size() / 3);
+  for(size_t t=0; t<order.size(); t++) order[t] = t;
+  std::shuffle(order.begin(), order.end(), std::mt19937(5));
+  std::vector<unsigned int> shuffled;
+  for(size_t t : order)
+    shuffled.insert(shuffled.end(), mesh.indices.begin() + t * 3, mesh.indices.begin() + t * 3 + 3);
+
+  std::vector<IndexedMesh> meshes = {mesh, mesh};
+  meshes[1].indices = shuffled;
+
+  CacheStats before = analyzeVertexCache(shuffled, mesh.vertexCount());
+  optimizeVertexCache(shuffled, mesh.vertexCount());
+  CacheStats after = analyzeVertexCache(shuffled, mesh.vertexCount());
+  CHECK(triangleSet(shuffled) == triangles);
+  CHECK(after.vertices == mesh.vertexCount());
+  CHECK(after.acmr() < before.acmr() * 0.5f);
+  CHECK(after.atvr() < 1.5f);
+
+  OptimizeOptions options;
+  options.vertexCache = true;
+  std::vector<OptimizeReport> reports = optimizeMeshes(meshes, options);
+  CHECK(reports.size() == 2 && reports[1].before.misses == before.misses);
+  CHECK(meshes[1].indices == shuffled);
+  CHECK(optimizeMeshes(meshes)[0].before.triangles == 0);
+}
+
+//box inside a box twice its size: from any side outer triangles cover inner ones,
+//so every outer cluster should be drawn before any inner one
+void testOverdraw(){
+  IndexedMesh outer = seamedBox(8), mesh = seamedBox(8);
+  for(size_t v=0; v<mesh.vertexCount(); v++)
+    for(int k=0; k<3; k++) mesh.vertices[v * 8 + k] = mesh.vertices[v * 8 + k] * 0.5f + 2.0f;
+  unsigned int innerVertices = static_cast<unsigned int>(mesh.vertexCount());
+  mesh.vertices.insert(mesh.vertices.end(), outer.vertices.begin(), outer.vertices.end());
+  for(unsigned int v : outer.indices) mesh.indices.push_back(v + innerVertices);
+
+  optimizeVertexCache(mesh.indices, mesh.vertexCount());
+  std::vector<std::array<unsigned int, 3>> triangles = triangleSet(mesh.indices);
+  CacheStats tipsified = analyzeVertexCache(mesh.indices, mesh.vertexCount());
+  optimizeOverdraw(mesh.indices, mesh.vertices);
+  CHECK(triangleSet(mesh.indices) == triangles);
+  CHECK(analyzeVertexCache(mesh.indices, mesh.vertexCount()).acmr() <= tipsified.acmr() * 1.15f);
+
+  size_t outerTriangles = outer.indices.size() / 3;
+  bool ordered = true;
+  for(size_t t=0; t<mesh.indices.size() / 3; t++)
+    ordered &= (mesh.indices[t * 3] >= innerVertices) == (t < outerTriangles);
+  CHECK(ordered);
+}
+
+//Morton order sorts used vertices along the Z-curve and drops unused ones, first use
+//numbers them as indices reach them. Both keep every corner on the same vertex data.
+void testVertexFetch(){
+  IndexedMesh box = seamedBox(4);
+  std::shuffle(box.indices.begin(), box.indices.end(), std::mt19937(9));
+  box.indices.resize(box.indices.size() / 2 / 3 * 3);
+  auto corners = [](const IndexedMesh& m){
+    std::vector<float> c;
+    for(unsigned int v : m.indices) c.insert(c.end(), &m.vertices[v * 8], &m.vertices[v * 8 + 8]);
+    return c;
+  };
+  std::vector<bool> used(box.vertexCount(), false);
+  for(unsigned int v : box.indices) used[v] = true;
+  size_t usedCount = std::count(used.begin(), used.end(), true);
+
+  IndexedMesh morton = box;
+  optimizeVertexFetch(morton, VertexOrder::Morton);
+  CHECK(morton.vertexCount() == usedCount && corners(morton) == corners(box));
+  float lo[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, extent = 0;
+  for(size_t v=0; v<morton.vertexCount(); v++)
+    for(int k=0; k<3; k++) lo[k] = std::min(lo[k], morton.vertices[v * 8 + k]);
+  for(size_t v=0; v<morton.vertexCount(); v++)
+    for(int k=0; k<3; k++) extent = std::max(extent, morton.vertices[v * 8 + k] - lo[k]);
+  auto code = [&](size_t v){
+    uint32_t q[3];
+    for(int k=0; k<3; k++) q[k] = static_cast<uint32_t>((morton.vertices[v * 8 + k] - lo[k]) / extent * 1023.0f + 0.5f);
+    return mortonCode(q[0], q[1], q[2]);
+  };
+  bool sorted = true;
+  for(size_t v=1; v<morton.vertexCount(); v++)
+    sorted &= code(v - 1) <= code(v);
+  CHECK(sorted);
+
+  IndexedMesh firstUse = box;
+  optimizeVertexFetch(firstUse, VertexOrder::FirstUse);
+  CHECK(firstUse.vertexCount() == usedCount && corners(firstUse) == corners(box));
+  unsigned int next = 0;
+  bool inOrder = true;
+  for(unsigned int v : firstUse.indices){
+    inOrder &= v <= next;
+    if(v == next) next++;
+  }
+  CHECK(inOrder && next == usedCount);
+}
+
+//------------------ meshlets
+
+glm::vec3 position(const IndexedMesh& mesh, unsigned int v){
+  return glm::vec3(mesh.vertices[v * 8], mesh.vertices[v * 8 + 1], mesh.vertices[v * 8 + 2]);
+}
+
+//meshlets cover indices in order, keep to the limits, bound every vertex they use
+//and only report backfacing for eyes behind all their triangles
+void checkMeshlets(const IndexedMesh& mesh, unsigned int maxVertices, unsigned int maxTriangles){
+  unsigned int offset = 0;
+  bool covered = true, limits = true, bounded = true, cones = true;
+  std::mt19937 rng(13);
+  std::uniform_real_distribution<float> eye(-20.0f, 36.0f);
+  for(const Meshlet& m : mesh.meshlets){
+    covered &= m.indexOffset == offset && m.indexCount > 0 && m.indexCount % 3 == 0;
+    offset += m.indexCount;
+    std::vector<unsigned int> used(mesh.indices.begin() + m.indexOffset, mesh.indices.begin() + m.indexOffset + m.indexCount);
+    std::sort(used.begin(), used.end());
+    used.erase(std::unique(used.begin(), used.end()), used.end());
+    limits &= used.size() == m.vertexCount && m.vertexCount <= maxVertices && m.indexCount / 3 <= maxTriangles;
+    for(unsigned int v : used){
+      glm::vec3 p = position(mesh, v);
+      bounded &= glm::length(p - m.center) <= m.radius * 1.0001f + 1e-5f;
+      bounded &= glm::all(glm::lessThanEqual(m.min, p)) && glm::all(glm::lessThanEqual(p, m.max));
+    }
+    for(int e=0; e<20; e++){
+      glm::vec3 from(eye(rng), eye(rng), eye(rng));
+      if(!meshletBackfacing(m, from)) continue;
+      for(unsigned int i=m.indexOffset; i<m.indexOffset + m.indexCount; i+=3){
+        glm::vec3 a = position(mesh, mesh.indices[i]), b = position(mesh, mesh.indices[i + 1]), c = position(mesh, mesh.indices[i + 2]);
+        cones &= glm::dot(glm::cross(b - a, c - a), from - a) <= 1e-3f;
+      }
+    }
+  }
+  CHECK(covered && offset == mesh.indices.size());
+  CHECK(limits);
+  CHECK(bounded);
+  CHECK(cones);
+}
+
+//triangles of every meshlet, to compare clusters after reordering
+std::vector<std::vector<std::array<unsigned int, 3>>> meshletSets(const IndexedMesh& mesh){
+  std::vector<std::vector<std::array<unsigned int, 3>>> sets;
+  for(const Meshlet& m : mesh.meshlets)
+    sets.push_back(triangleSet(std::vector<unsigned int>(mesh.indices.begin() + m.indexOffset, mesh.indices.begin() + m.indexOffset + m.indexCount)));
+  std::sort(sets.begin(), sets.end());
+  return sets;
+}
+
+void testMeshlets(){
+  IndexedMesh box = seamedBox(16);
+  std::vector<std::array<unsigned int, 3>> triangles = triangleSet(box.indices);
+  box.meshlets = buildMeshlets(box.indices, box.vertices, 64, 124);
+  CHECK(triangleSet(box.indices) == triangles);
+  CHECK(box.meshlets.size() >= box.indices.size() / 3 / 124);
+  checkMeshlets(box, 64, 124);
+
+  //bumps push outward, clamped away every face is flat. A cluster on one face has a
+  //zero width cone and seen from behind its plane it is backfacing.
+  IndexedMesh flatBox = seamedBox(16);
+  for(size_t i=0; i<flatBox.vertices.size(); i += 8)
+    for(int k=0; k<3; k++) flatBox.vertices[i + k] = glm::clamp(flatBox.vertices[i + k], 0.0f, 16.0f);
+  flatBox.meshlets = buildMeshlets(flatBox.indices, flatBox.vertices);
+  checkMeshlets(flatBox, 64, 124);
+  size_t flat = 0;
+  for(const Meshlet& m : flatBox.meshlets)
+    if(m.coneCutoff < 1e-3f && !meshletBackfacing(m, m.center + m.coneAxis * 5.0f)){
+      flat++;
+      CHECK(meshletBackfacing(m, m.center - m.coneAxis * (m.radius + 5.0f)));
+    }
+  CHECK(flat > 0);
+
+  IndexedMesh small = seamedBox(16);
+  small.meshlets = buildMeshlets(small.indices, small.vertices, 16, 8);
+  checkMeshlets(small, 16, 8);
+}
+
+//cache and overdraw stages keep meshlet clusters whole, Tipsify still pays off inside them
+void testMeshletOrder(){
+  std::vector<IndexedMesh> meshes = {seamedBox(16)};
+  std::shuffle(meshes[0].indices.begin(), meshes[0].indices.end(), std::mt19937(17)); //scrambles triangles too
+  OptimizeOptions options;
+  options.meshlets = true;
+  std::vector<IndexedMesh> plain = meshes;
+  optimizeMeshes(plain, options);
+
+  options.vertexCache = options.overdraw = true;
+  std::vector<OptimizeReport> reports = optimizeMeshes(meshes, options);
+  CHECK(meshletSets(meshes[0]) == meshletSets(plain[0]));
+  checkMeshlets(meshes[0], options.meshletVertices, options.meshletTriangles);
+  CHECK(reports[0].after.acmr() < analyzeVertexCache(plain[0].indices, plain[0].vertexCount()).acmr());
+}
+
+//------------------ simplification
+
+//levels shrink, stay inside vertex buffer and keep the surface closed
+void checkLods(const IndexedMesh& mesh, const std::vector<LodLevel>& lods){
+  CHECK(!lods.empty());
+  size_t previous = mesh.indices.size();
+  float error = 0.0f;
+  for(const LodLevel& lod : lods){
+    CHECK(lod.indices.size() % 3 == 0);
+    CHECK(lod.indices.size() <= previous * 9 / 10);
+    CHECK(lod.error >= error);
+    CHECK(openEdges(lod.indices, mesh.vertices) == 0);
+    for(unsigned int v : lod.indices)
+      CHECK(v < mesh.vertexCount());
+    previous = lod.indices.size();
+    error = lod.error;
+  }
+}
+
+void testSimplify(){
+  IndexedMesh seamed = seamedBox(16);
+  CHECK(openEdges(seamed.indices, seamed.vertices) == 0);
+  checkLods(seamed, buildLods(seamed, 4));
+
+  //seams alone lock nothing, levels come from simplifyMesh
+  std::vector<unsigned int> indices = seamed.indices;
+  simplifyMesh(indices, seamed.vertices, seamed.indices.size() / 2);
+  CHECK(indices.size() <= seamed.indices.size() * 9 / 10);
+  CHECK(openEdges(indices, seamed.vertices) == 0);
+
+  //every vertex on a seam, position-only fallback still gives levels
+  IndexedMesh flat = flatShaded(seamed);
+  checkLods(flat, buildLods(flat, 4));
+}
+
+//------------------ LOD cache
+
+void testLodCache(){
+  writeFile("lodsource.obj", "v 0 0 0\n");
+  std::filesystem::remove("lodcache.lod");
+  OptimizeOptions options;
+  options.lodLevels = 3;
+  options.lodCache = "lodcache.lod";
+  options.lodSource = "lodsource.obj";
+
+  std::vector<IndexedMesh> built = {seamedBox(8), flatShaded(seamedBox(6))};
+  optimizeMeshes(built, options);
+  CHECK(std::filesystem::exists("lodcache.lod"));
+
+  std::vector<IndexedMesh> read = {seamedBox(8), flatShaded(seamedBox(6))};
+  CHECK(readLodCache(read, options));
+  for(size_t i=0; i<read.size(); i++){
+    CHECK(read[i].lods.size() == built[i].lods.size());
+    for(size_t l=0; l<read[i].lods.size() && l<built[i].lods.size(); l++){
+      CHECK(read[i].lods[l].indices == built[i].lods[l].indices);
+      CHECK(read[i].lods[l].error == built[i].lods[l].error);
+    }
+  }
+
+  //other level count, other meshes or edited source make it stale
+  OptimizeOptions levels = options;
+  levels.lodLevels = 2;
+  CHECK(!readLodCache(read, levels));
+  std::vector<IndexedMesh> other = {seamedBox(8), seamedBox(6)};
+  CHECK(!readLodCache(other, options));
+  writeFile("lodsource.obj", "v 1 0 0\n");
+  CHECK(!readLodCache(read, options));
+}
+
+//------------------ quantization
+
+void testHalf(){
+  CHECK(halfFromFloat(1.0f) == 0x3C00 && halfFromFloat(-2.0f) == 0xC000);
+  CHECK(halfFromFloat(65504.0f) == 0x7BFF && halfFromFloat(65520.0f) == 0x7C00);
+  CHECK(halfFromFloat(std::ldexp(1.0f, -24)) == 1 && halfFromFloat(std::ldexp(1.0f, -25)) == 0);
+  CHECK(halfFromFloat(std::ldexp(3.0f, -25)) == 2); //tie between denormals 1 and 2 goes even
+  CHECK(halfFromFloat(1.0f + std::ldexp(1.0f, -11)) == 0x3C00);
+  CHECK(halfFromFloat(1.0f + std::ldexp(3.0f, -11)) == 0x3C02);
+  CHECK(halfFromFloat(-0.0f) == 0x8000 && halfFromFloat(INFINITY) == 0x7C00);
+  CHECK((halfFromFloat(NAN) & 0x7E00) == 0x7E00);
+}
+
+//both paths match a plain loop for odd and even counts, normal x next to position
+//is never read into the bounds
+void testPositionBounds(){
+  std::mt19937 rng(19);
+  std::uniform_real_distribution<float> unit(-10.0f, 10.0f);
+  for(size_t count : {size_t(0), size_t(1), size_t(2), size_t(3), size_t(7), size_t(1000)}){
+    std::vector<float> vertices(count * 8);
+    for(size_t i=0; i<vertices.size(); i++)
+      vertices[i] = i % 8 == 3 ? (i % 16 == 3 ? 1e9f : -1e9f) : unit(rng);
+    float expectLo[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, expectHi[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for(size_t v=0; v<count; v++)
+      for(int k=0; k<3; k++){
+        expectLo[k] = std::min(expectLo[k], vertices[v * 8 + k]);
+        expectHi[k] = std::max(expectHi[k], vertices[v * 8 + k]);
+      }
+    for(bool simd : {true, false}){
+      float lo[3], hi[3];
+      positionBounds(vertices.data(), count, lo, hi, simd);
+      CHECK(std::equal(lo, lo + 3, expectLo) && std::equal(hi, hi + 3, expectHi));
+    }
+  }
+}
+
+//SSE2 kernels and scalar path give the same bytes, including rounding ties, -0
+//normals, normals in the lower hemisphere and vertex counts that are not a multiple of 4
+void testQuantize(){
+  std::mt19937 rng(11);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  IndexedMesh mesh;
+  for(int i=0; i<1001; i++){
+    float v[8] = {unit(rng) * 50.0f, unit(rng), unit(rng) * 3.0f + 7.0f, unit(rng), unit(rng), unit(rng), unit(rng) * 4.0f, unit(rng) * 4.0f};
+    if(i % 5 == 0) v[6] = 1.0f + std::ldexp(float(i % 7), -11); //half rounding ties
+    if(i % 7 == 0) v[3] = -0.0f, v[4] = 0.0f, v[5] = -1.0f;
+    if(i % 11 == 0) v[3] = v[4] = v[5] = 0.0f;
+    mesh.vertices.insert(mesh.vertices.end(), v, v + 8);
+  }
+  //exact grid positions land on .5 before rounding
+  mesh.vertices[0] = -50.0f, mesh.vertices[8] = 50.0f, mesh.vertices[16] = 50.0f / 65535.0f - 50.0f;
+
+  for(VertexFormat format : {VertexFormat::Oct16, VertexFormat::Packed1010102, VertexFormat::Oct8}){
+    QuantizedMesh fast = quantizeMesh(mesh, format), scalar = quantizeMesh(mesh, format, false);
+    CHECK(fast.vertexCount() == mesh.vertexCount() && fast.vertices == scalar.vertices);
+    uint16_t x[2];
+    std::memcpy(&x[0], &fast.vertices[0], 2);
+    std::memcpy(&x[1], &fast.vertices[fast.stride], 2);
+    CHECK(x[0] == 0 && x[1] == 65535);
+    CHECK(fast.dequantize[0][0] == 100.0f && fast.dequantize[3][0] == -50.0f);
+  }
+  CHECK(quantizeMesh(mesh, VertexFormat::Float).vertices.size() == mesh.vertices.size() * 4);
+  CHECK(quantizeMesh(IndexedMesh(), VertexFormat::Oct16).vertexCount() == 0);
+}
+
+//------------------ thread pool
+
+//every index runs once whatever the thread count, also with pool jobs nested in work
+//and with several threads using the pool at once. The pool has its own workers, so
+//this holds on single core machines too, where threadPool() has none.
+void testThreadPool(){
+  auto once = [](const std::vector<std::atomic<int>>& seen, int times){
+    return std::all_of(seen.begin(), seen.end(), [&](const std::atomic<int>& s){ return s == times; });
+  };
+  ThreadPool pool(3);
+  for(unsigned int helpers : {0u, 1u, 3u, 64u}){
+    std::vector<std::atomic<int>> seen(10000);
+    auto work = [&](size_t i){ seen[i]++; };
+    pool.run(seen.size(), helpers, work);
+    CHECK(once(seen, 1));
+  }
+
+  std::vector<std::atomic<int>> nested(64 * 500);
+  auto outer = [&](size_t i){
+    auto inner = [&](size_t j){ nested[i * 500 + j]++; };
+    pool.run(500, 3, inner);
+  };
+  pool.run(64, 3, outer);
+  CHECK(once(nested, 1));
+
+  std::vector<std::atomic<int>> shared(4 * 5000);
+  std::vector<std::thread> callers;
+  for(size_t c=0; c<4; c++)
+    callers.emplace_back([&, c](){
+      auto work = [&](size_t i){ shared[c * 5000 + i]++; };
+      for(int round=0; round<20; round++)
+        pool.run(5000, 3, work);
+    });
+  for(std::thread& t : callers) t.join();
+  CHECK(once(shared, 20));
+
+  std::vector<std::atomic<int>> seen(1000);
+  parallelFor(seen.size(), 0, [&](size_t i){
+    parallelFor(1, 4, [&](size_t){ seen[i]++; });
+  });
+  CHECK(once(seen, 1));
+  parallelFor(0, 0, [](size_t){ CHECK(false); });
+}
+
+int main(){
+  testWelder();
+  testBuildIndexed();
+  testAnalyzeVertexCache();
+  testTipsify();
+  testOverdraw();
+  testVertexFetch();
+  testMeshlets();
+  testMeshletOrder();
+  testSimplify();
+  testLodCache();
+  testPositionBounds();
+  testHalf();
+  testQuantize();
+  testThreadPool();
+  return report("meshOptimizer");
+}
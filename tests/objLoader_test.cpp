@@ -0,0 +1,530 @@
+#include "objLoader.h"
+#include "test.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <sstream>
+
+using namespace objLoader;
+
+//------------------ parseFloat
+
+//fast path has to agree with from_chars bit for bit, with and without slack past the token
+void testParseFloat(){
+  std::mt19937 rng(1);
+  char big[256];
+  const char* formats[] = {"%.9g", "%.6f", "%.3e", "%g"};
+  for(int i=0; i<200000; i++){
+    uint32_t bits = rng();
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    if(!std::isfinite(value) || std::abs(value) > 1e30f || (value != 0.0f && std::abs(value) < 1e-30f)) continue;
+    char text[64];
+    int n = std::snprintf(text, sizeof(text), formats[i % 4], value);
+    float expect = 0.0f, fast = 0.0f, slack = 0.0f;
+    auto res = std::from_chars(text, text + n, expect);
+    if(res.ec != std::errc()) continue;
+    std::memset(big, ' ', sizeof(big));
+    std::memcpy(big, text, n);
+    NumberError e1 = parseFloat(std::string_view(text, n), fast);
+    NumberError e2 = parseFloat(std::string_view(big, n), slack, big + sizeof(big));
+    CHECK(e1 == NumberError::None && e2 == NumberError::None);
+    CHECK(std::bit_cast<uint32_t>(fast) == std::bit_cast<uint32_t>(expect));
+    CHECK(std::bit_cast<uint32_t>(slack) == std::bit_cast<uint32_t>(expect));
+  }
+
+  struct Case{ const char* text; NumberError error; float value; };
+  const Case cases[] = {
+    {"1", NumberError::None, 1.0f},
+    {"-0.5", NumberError::None, -0.5f},
+    {"+2.5", NumberError::None, 2.5f},
+    {"1e3", NumberError::None, 1000.0f},
+    {"1E-3", NumberError::None, 1e-3f},
+    {"5.", NumberError::None, 5.0f},
+    {"123456789012345678901234", NumberError::None, 123456789012345678901234.0f},
+    {"0.000000000000000000000000000000000000000000001", NumberError::None, 1e-45f},
+    {"", NumberError::Empty, 0.0f},
+    {"1e", NumberError::Invalid, 0.0f},
+    {"1e+", NumberError::Invalid, 0.0f},
+    {"1.0abc", NumberError::Invalid, 0.0f},
+    {"0x1p3", NumberError::Invalid, 0.0f},
+    {"abc", NumberError::Invalid, 0.0f},
+    {"-", NumberError::Invalid, 0.0f},
+    {"+-1", NumberError::Invalid, 0.0f},
+    {"1e99", NumberError::OutOfRange, 0.0f},
+  };
+  for(const Case& c : cases){
+    float value = 0.0f;
+    NumberError e = parseFloat(c.text, value);
+    if(e != c.error || (e == NumberError::None && value != c.value))
+      std::cout << "parseFloat(\"" << c.text << "\")" << std::endl;
+    CHECK(e == c.error);
+    if(e == NumberError::None) CHECK(value == c.value);
+  }
+}
+
+
+//------------------ parse round trip
+
+struct Expected{
+  std::vector<Object> Objects;
+  std::string text;
+};
+
+std::string format(float x){
+  char text[32];
+  std::snprintf(text, sizeof(text), "%.9g", x);
+  return text;
+}
+
+//random scene of several objects and materials, with the arrays the loader has to produce
+Expected randomScene(uint32_t seed){
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+  Expected out;
+  std::ostringstream obj;
+  obj << "# generated\nmtllib roundtrip.mtl\n";
+  unsigned int vBase = 0, vtBase = 0, vnBase = 0;
+  for(int o=0; o<3; o++){
+    std::string name = "object" + std::to_string(o);
+    obj << "o " << name << "\n";
+    std::vector<Vec3> V, T, N;
+    unsigned int count = 20 + rng() % 50;
+    for(unsigned int i=0; i<count; i++){
+      V.push_back(Vec3(value(rng), value(rng), value(rng)));
+      T.push_back(Vec3(value(rng) / 100.0f, value(rng) / 100.0f, 0.0f));
+      N.push_back(Vec3(value(rng) / 100.0f, value(rng) / 100.0f, value(rng) / 100.0f));
+      obj << "v " << format(V.back().x) << " " << format(V.back().y) << " " << format(V.back().z) << "\n";
+      obj << "vt " << format(T.back().x) << " " << format(T.back().y) << "\n";
+      obj << "vn " << format(N.back().x) << " " << format(N.back().y) << " " << format(N.back().z) << "\n";
+    }
+    std::vector<Mesh> meshes;
+    for(int m=0; m<2; m++){
+      std::string mtl = m ? "red" : "green";
+      obj << "usemtl " << mtl << "\n";
+      std::vector<Index> corners;
+      unsigned int triangles = 10 + rng() % 30;
+      for(unsigned int t=0; t<triangles; t++){
+        unsigned int v[3];
+        obj << "f";
+        for(unsigned int& x : v){
+          x = rng() % count;
+          //every third face uses negative indices, relative to vertices read so far
+          if(t % 3 == 2) obj << " -" << count - x << "/-" << count - x << "/-" << count - x;
+          else obj << " " << vBase + x + 1 << "/" << vtBase + x + 1 << "/" << vnBase + x + 1;
+        }
+        obj << "\n";
+        Face f(vBase + v[0] + 1, vBase + v[1] + 1, vBase + v[2] + 1);
+        Face ft(vtBase + v[0] + 1, vtBase + v[1] + 1, vtBase + v[2] + 1);
+        Face fn(vnBase + v[0] + 1, vnBase + v[1] + 1, vnBase + v[2] + 1);
+        corners.push_back(Index(f, ft, fn));
+      }
+      meshes.push_back(Mesh(corners, mtl, vBase, vtBase, vnBase));
+    }
+    out.Objects.push_back(Object(name, V, T, N, std::move(meshes)));
+    vBase += count;
+    vtBase += count;
+    vnBase += count;
+  }
+  out.text = obj.str();
+  return out;
+}
+
+bool sameObjects(const std::vector<Object>& a, const std::vector<Object>& b){
+  if(a.size() != b.size()) return false;
+  for(size_t o=0; o<a.size(); o++){
+    if(a[o].name != b[o].name || a[o].vertices != b[o].vertices || a[o].normals != b[o].normals || a[o].meshes.size() != b[o].meshes.size()) return false;
+    //vt keeps only u and v
+    if(a[o].texCoords.size() != b[o].texCoords.size()) return false;
+    for(size_t i=0; i<a[o].texCoords.size(); i++)
+      if(i % 3 != 2 && a[o].texCoords[i] != b[o].texCoords[i]) return false;
+    for(size_t m=0; m<a[o].meshes.size(); m++){
+      const Mesh& x = a[o].meshes[m];
+      const Mesh& y = b[o].meshes[m];
+      if(x.mtl != y.mtl || x.positions != y.positions || x.texPositions != y.texPositions || x.normPositions != y.normPositions) return false;
+    }
+  }
+  return true;
+}
+
+const char* roundTripMtl =
+  "newmtl green\n"
+  "Kd 0 1 0\n"
+  "newmtl red\n"
+  "Kd 1 0 0\n"
+  "d 0.5\n";
+
+//every parse path gives the same arrays as were written
+void testRoundTrip(){
+  writeFile("roundtrip.mtl", roundTripMtl);
+  for(uint32_t seed=1; seed<=5; seed++){
+    Expected scene = randomScene(seed);
+    writeFile("roundtrip.obj", scene.text);
+
+    LoadOptions text, mapped, parallel, tiny;
+    mapped.mapFile = true;
+    parallel.threads = 4;
+    tiny.threads = 500; //chunks of a few lines, some of them empty
+    for(const LoadOptions* options : {&text, &mapped, &parallel, &tiny}){
+      std::vector<Object> Objects;
+      std::vector<Material> Materials;
+      CHECK(loadObject(Objects, Materials, "roundtrip.obj", *options));
+      CHECK(sameObjects(Objects, scene.Objects));
+      CHECK(Materials.size() == 3 && Materials[2].name == "red" && Materials[2].opacity == 0.5f); //Default comes first
+    }
+    std::vector<Object> Objects;
+    std::vector<Material> Materials;
+    std::istringstream in(scene.text);
+    CHECK(loadObject(Objects, Materials, in));
+    CHECK(sameObjects(Objects, scene.Objects));
+
+    //pieces of random size, lines split anywhere
+    std::vector<Object> Fed;
+    size_t meshes = 0;
+    StreamParser parser(Fed, Materials);
+    parser.setMeshCallback([&](const Mesh&, const std::string&){ meshes++; });
+    std::mt19937 rng(seed);
+    for(size_t at=0; at<scene.text.size();){
+      size_t n = std::min<size_t>(1 + rng() % 40, scene.text.size() - at);
+      CHECK(parser.feed(scene.text.data() + at, n));
+      at += n;
+    }
+    CHECK(parser.finish());
+    CHECK(sameObjects(Fed, scene.Objects));
+    CHECK(meshes == 6);
+  }
+}
+
+//malformed numbers fail the load instead of being read as a prefix
+void testMalformed(){
+  const char* lines[] = {"v 1.0abc 2 3\n", "v 1e 2 3\n", "v 0x1p3 2 3\n", "v 1 2\n"};
+  for(const char* line : lines){
+    std::string text = std::string("v 0 0 0\nv 1 0 0\nv 0 1 0\n") + line + "f 1 2 3\n";
+    writeFile("malformed.obj", text);
+    std::vector<Object> Objects;
+    std::vector<Material> Materials;
+    CHECK(!loadObject(Objects, Materials, "malformed.obj"));
+  }
+}
+
+//negative indices reaching before the first vertex fail on every path, also when
+//the face sits in a later chunk than the vertices
+void testRelative(){
+  std::string padding;
+  for(int i=0; i<200; i++) padding += "# padding line\n";
+  struct Case{ const char* face; bool ok; };
+  const Case cases[] = {
+    {"f -1 -2 -3\n", true}, {"f -3/-1 -2/-1 -1/-1\n", true},
+    {"f -5 -2 -1\n", false}, {"f -0 -2 -1\n", false}, {"f -1 -2 -4\n", false},
+    {"f 1/-2 2/-1 3/-1\n", false}, {"f -2147483648 -2 -1\n", false},
+  };
+  LoadOptions text, mapped, parallel;
+  mapped.mapFile = true;
+  parallel.threads = 8;
+  for(const Case& c : cases){
+    writeFile("relative.obj", std::string("v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\n") + padding + c.face);
+    for(const LoadOptions* options : {&text, &mapped, &parallel}){
+      std::vector<Object> Objects;
+      std::vector<Material> Materials;
+      bool ok = loadObject(Objects, Materials, "relative.obj", *options);
+      if(ok != c.ok) std::cout << c.face << " threads " << options->threads << std::endl;
+      CHECK(ok == c.ok);
+      if(ok) CHECK(Objects.size() == 1 && Objects[0].meshes[0].positions[0] + Objects[0].meshes[0].positions[2] == 2);
+    }
+  }
+}
+
+//mapped file ends without newline and has no terminator past the last byte
+void testUnterminated(){
+  writeFile("unterminated.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3");
+  LoadOptions mapped, parallel;
+  mapped.mapFile = true;
+  parallel.threads = 3;
+  for(const LoadOptions* options : {&mapped, &parallel}){
+    std::vector<Object> Objects;
+    std::vector<Material> Materials;
+    CHECK(loadObject(Objects, Materials, "unterminated.obj", *options));
+    CHECK(Objects.size() == 1 && Objects[0].meshes.size() == 1 && Objects[0].meshes[0].positions.size() == 3 && Objects[0].meshes[0].positions[2] == 2);
+  }
+}
+
+//------------------ scanner
+
+//block scanner agrees with a byte loop for every window, including ones ending mid block
+void testScanner(){
+  std::mt19937 rng(7);
+  const char alphabet[] = " \t\r\n\v\f/ab1-.";
+  std::string text;
+  for(int i=0; i<300; i++) text += alphabet[rng() % (sizeof(alphabet) - 1)];
+  const char* limit = text.data() + text.size();
+  std::pmr::vector<std::string_view> tokens;
+  for(int i=0; i<2000; i++){
+    size_t a = rng() % text.size(), b = a + rng() % (text.size() - a + 1);
+    const char* first = text.data() + a;
+    const char* last = text.data() + b;
+
+    std::vector<std::string_view> expected;
+    const char* start = nullptr;
+    for(const char* p=first; p<last; p++){
+      bool space = std::strchr(" \t\r\n\v\f", *p) != nullptr;
+      if(space && start){ expected.emplace_back(start, p - start); start = nullptr; }
+      else if(!space && !start) start = p;
+    }
+    if(start) expected.emplace_back(start, last - start);
+    splitTokens(tokens, first, last, limit);
+    CHECK(tokens.size() == expected.size());
+    for(size_t t=0; t<tokens.size() && t<expected.size(); t++)
+      CHECK(tokens[t].data() == expected[t].data() && tokens[t].size() == expected[t].size());
+
+    const char* slash = std::find(first, last, '/');
+    CHECK(findByte(first, last, '/', limit) == slash);
+    CHECK(findByte(first, last, '/', last) == slash);
+  }
+}
+
+//------------------ materials and sidecar cache
+
+bool sameMaterials(const std::vector<Material>& a, const std::vector<Material>& b){
+  if(a.size() != b.size()) return false;
+  for(size_t i=0; i<a.size(); i++)
+    if(a[i].name != b[i].name || a[i].DiffuseMap != b[i].DiffuseMap || !std::equal(a[i].diffuse, a[i].diffuse + 3, b[i].diffuse) || a[i].opacity != b[i].opacity)
+      return false;
+  return true;
+}
+
+void testMtllib(){
+  const char* geometry = "v 0 0 0\nv 1 0 0\nv 0 1 0\nusemtl red\nf 1 2 3\n";
+  std::vector<Object> Objects;
+  std::vector<Material> Materials;
+
+  //missing file: geometry still loads, result is false and no sidecar is written
+  std::filesystem::remove("nomtl.obj.bin");
+  writeFile("nomtl.obj", std::string("mtllib missing.mtl\n") + geometry);
+  LoadOptions cached;
+  cached.useCache = true;
+  CHECK(!loadObject(Objects, Materials, "nomtl.obj", cached));
+  CHECK(Objects.size() == 1 && Objects[0].meshes.size() == 1);
+  CHECK(!std::filesystem::exists("nomtl.obj.bin"));
+
+  //newmtl and map_Kd without argument
+  const char* broken[] = {"newmtl\nKd 1 0 0\n", "newmtl red\nmap_Kd\n", "newmtl red\nKd 1 x 0\n"};
+  for(const char* mtl : broken){
+    writeFile("broken.mtl", mtl);
+    writeFile("broken.obj", std::string("mtllib broken.mtl\n") + geometry);
+    Objects.clear();
+    Materials.clear();
+    CHECK(!loadObject(Objects, Materials, "broken.obj"));
+    CHECK(Objects.size() == 1);
+  }
+}
+
+//sidecar is reused while .obj and its .mtl files are unchanged, rebuilt when either is edited
+void testCache(){
+  Expected scene = randomScene(7);
+  writeFile("cached.obj", scene.text);
+  writeFile("roundtrip.mtl", roundTripMtl);
+  std::filesystem::remove("cached.obj.bin");
+  LoadOptions options;
+  options.useCache = true;
+
+  std::vector<Object> parsed, cached;
+  std::vector<Material> parsedMaterials, cachedMaterials;
+  CHECK(loadObject(parsed, parsedMaterials, "cached.obj", options));
+  CHECK(std::filesystem::exists("cached.obj.bin"));
+  CHECK(ModelCache("cached.obj.bin", "cached.obj").isValid());
+  CHECK(loadObject(cached, cachedMaterials, "cached.obj", options));
+  CHECK(sameObjects(cached, scene.Objects));
+  CHECK(sameMaterials(cachedMaterials, parsedMaterials));
+
+  //same size and most likely same mtime, only the hash tells them apart
+  writeFile("roundtrip.mtl", "newmtl green\nKd 0 1 0\nnewmtl red\nKd 0 0 1\nd 0.5\n");
+  CHECK(!ModelCache("cached.obj.bin", "cached.obj").isValid());
+  cached.clear();
+  cachedMaterials.clear();
+  CHECK(loadObject(cached, cachedMaterials, "cached.obj", options));
+  CHECK(cachedMaterials.size() == 3 && cachedMaterials[2].diffuse[2] == 1.0f);
+  CHECK(ModelCache("cached.obj.bin", "cached.obj").isValid());
+
+  //removed .mtl invalidates it too
+  std::filesystem::remove("roundtrip.mtl");
+  CHECK(!ModelCache("cached.obj.bin", "cached.obj").isValid());
+  writeFile("roundtrip.mtl", roundTripMtl);
+
+  //edited .obj
+  scene = randomScene(8);
+  writeFile("cached.obj", scene.text);
+  CHECK(!ModelCache("cached.obj.bin", "cached.obj").isValid());
+  cached.clear();
+  cachedMaterials.clear();
+  CHECK(loadObject(cached, cachedMaterials, "cached.obj", options));
+  CHECK(sameObjects(cached, scene.Objects));
+}
+
+//views over a valid sidecar point into the mapping and match the copied objects,
+//without one they point into parsed objects; copies keep either alive
+void testView(){
+  Expected scene = randomScene(9);
+  writeFile("view.obj", scene.text);
+  writeFile("roundtrip.mtl", roundTripMtl);
+  std::filesystem::remove("view.obj.bin");
+
+  auto same = [](const ModelView& view, const std::vector<Object>& objects){
+    if(view.Objects.size() != objects.size()) return false;
+    for(size_t o=0; o<objects.size(); o++){
+      const ObjectView& a = view.Objects[o];
+      const Object& b = objects[o];
+      if(a.name != b.name || !std::ranges::equal(a.vertices, b.vertices) || !std::ranges::equal(a.texCoords, b.texCoords) ||
+         !std::ranges::equal(a.normals, b.normals) || a.meshes.size() != b.meshes.size()) return false;
+      for(size_t m=0; m<b.meshes.size(); m++)
+        if(a.meshes[m].mtl != b.meshes[m].mtl || !std::ranges::equal(a.meshes[m].positions, b.meshes[m].positions) ||
+           !std::ranges::equal(a.meshes[m].texPositions, b.meshes[m].texPositions) || !std::ranges::equal(a.meshes[m].normPositions, b.meshes[m].normPositions)) return false;
+    }
+    return true;
+  };
+  std::vector<Object> copied;
+  std::vector<Material> copiedMaterials;
+  LoadOptions options;
+  options.useCache = true;
+
+  //cold: parsed fallback, sidecar written
+  ModelView cold;
+  std::vector<Material> coldMaterials;
+  CHECK(loadObjectView(cold, coldMaterials, "view.obj"));
+  CHECK(!cold.isMapped() && cold.parsed);
+  CHECK(std::filesystem::exists("view.obj.bin"));
+
+  //warm: spans lie inside the mapped sidecar
+  ModelView warm;
+  std::vector<Material> warmMaterials;
+  CHECK(loadObjectView(warm, warmMaterials, "view.obj"));
+  CHECK(warm.isMapped() && !warm.parsed);
+  CHECK(loadObject(copied, copiedMaterials, "view.obj", options));
+  CHECK(sameObjects(copied, scene.Objects));
+  CHECK(same(cold, copied) && same(warm, copied));
+  CHECK(sameMaterials(warmMaterials, copiedMaterials) && sameMaterials(coldMaterials, copiedMaterials));
+  const char* begin = warm.cache->file.data;
+  const char* end = begin + warm.cache->file.size;
+  for(const ObjectView& o : warm.Objects){
+    const char* v = reinterpret_cast<const char*>(o.vertices.data());
+    CHECK(v >= begin && v + o.vertices.size_bytes() <= end && reinterpret_cast<uintptr_t>(v) % 64 == 0);
+    for(const MeshView& m : o.meshes){
+      const char* p = reinterpret_cast<const char*>(m.positions.data());
+      CHECK(p >= begin && p + m.positions.size_bytes() <= end);
+    }
+  }
+
+  //copies outlive the loaded models
+  ModelView kept = warm, keptCold = cold;
+  warm = ModelView();
+  cold = ModelView();
+  CHECK(same(kept, copied) && same(keptCold, copied));
+}
+
+//------------------ visitor
+
+//counts hooks and keeps faces as parseObj hands them over
+struct Recorder : ObjVisitor{
+  size_t vertices = 0, texCoords = 0, normals = 0;
+  std::vector<std::vector<unsigned int>> faces; //v, vt, vn of every corner
+  std::vector<std::string> events;
+
+  void onVertex(float, float, float){ vertices++; }
+  void onTexCoord(float, float, float){ texCoords++; }
+  void onNormal(float, float, float){ normals++; }
+  void onFace(const Corner* corners, size_t n){
+    faces.emplace_back();
+    for(size_t i=0; i<n; i++)
+      faces.back().insert(faces.back().end(), {corners[i].v, corners[i].vt, corners[i].vn});
+  }
+  void onObject(std::string_view name){ events.push_back("o " + std::string(name)); }
+  void onGroup(std::string_view name){ events.push_back("g " + std::string(name)); }
+  void onUseMtl(std::string_view name){ events.push_back("usemtl " + std::string(name)); }
+  void onMtllib(std::string_view path){ events.push_back("mtllib " + std::string(path)); }
+};
+
+//hooks come in file order with relative indices already resolved and missing parts 0,
+//polygons are passed whole
+void testVisitor(){
+  const char text[] =
+    "mtllib a.mtl\no first\nv 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nvt 1 0\nvn 0 0 1\n"
+    "usemtl red\nf -3/-2/-1 -2/-1/-1 -1/-1/-1\ng\nv 1 1 0\nf 1 -3 3 -1\n"
+    "o second\nf 1//1 2//1 3//1\n";
+  Recorder r;
+  CHECK(parseObj(r, text, text + sizeof(text) - 1));
+  CHECK(r.vertices == 4 && r.texCoords == 2 && r.normals == 1);
+  CHECK(r.faces.size() == 3);
+  CHECK(r.faces[0] == std::vector<unsigned int>({1, 1, 1, 2, 2, 1, 3, 2, 1}));
+  CHECK(r.faces[1] == std::vector<unsigned int>({1, 0, 0, 2, 0, 0, 3, 0, 0, 4, 0, 0}));
+  CHECK(r.faces[2] == std::vector<unsigned int>({1, 0, 1, 2, 0, 1, 3, 0, 1}));
+  CHECK(r.events == std::vector<std::string>({"mtllib a.mtl", "o first", "usemtl red", "g ", "o second"}));
+
+  //out of range relative index stops the parse
+  const char bad[] = "v 0 0 0\nf -1 -2 -1\n";
+  Recorder b;
+  CHECK(!parseObj(b, bad, bad + sizeof(bad) - 1));
+  CHECK(b.faces.empty());
+}
+
+//------------------ interleaved loader
+
+//batches hold the same triangles loadObject gives, expanded to position, normal, uv
+void testInterleaved(){
+  writeFile("roundtrip.mtl", roundTripMtl);
+  for(uint32_t seed=11; seed<=13; seed++){
+    Expected scene = randomScene(seed);
+    writeFile("interleaved.obj", scene.text);
+    std::vector<InterleavedObject> Objects;
+    std::vector<Material> Materials;
+    CHECK(loadInterleaved(Objects, Materials, "interleaved.obj"));
+    CHECK(Materials.size() == 3);
+    CHECK(Objects.size() == scene.Objects.size());
+    for(size_t o=0; o<Objects.size() && o<scene.Objects.size(); o++){
+      const Object& ref = scene.Objects[o];
+      CHECK(Objects[o].name == ref.name && Objects[o].batches.size() == ref.meshes.size());
+      for(size_t b=0; b<Objects[o].batches.size() && b<ref.meshes.size(); b++){
+        const InterleavedBatch& batch = Objects[o].batches[b];
+        const Mesh& m = ref.meshes[b];
+        std::vector<float> expected;
+        for(size_t i=0; i<m.positions.size(); i++){
+          expected.insert(expected.end(), &ref.vertices[m.positions[i] * 3], &ref.vertices[m.positions[i] * 3] + 3);
+          expected.insert(expected.end(), &ref.normals[m.normPositions[i] * 3], &ref.normals[m.normPositions[i] * 3] + 3);
+          expected.insert(expected.end(), {ref.texCoords[m.texPositions[i] * 3], ref.texCoords[m.texPositions[i] * 3 + 1]});
+        }
+        CHECK(batch.mtl == m.mtl && batch.state == 3);
+        CHECK(std::equal(batch.vertices.begin(), batch.vertices.end(), expected.begin(), expected.end()));
+      }
+    }
+  }
+
+  //missing normals and uvs get Renderer's defaults, a quad becomes two triangles
+  writeFile("plain.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n");
+  std::vector<InterleavedObject> Objects;
+  std::vector<Material> Materials;
+  CHECK(loadInterleaved(Objects, Materials, "plain.obj"));
+  CHECK(Objects.size() == 1 && Objects[0].batches.size() == 1);
+  const InterleavedBatch& batch = Objects[0].batches[0];
+  CHECK(batch.state == 0 && batch.vertices.size() == 6 * 8);
+  const float corner[8] = {1, 1, 0, 0, 1, 0, 0, 1}; //third corner of first triangle
+  CHECK(batch.vertices.size() == 48 && std::equal(corner, corner + 8, batch.vertices.begin() + 16));
+}
+
+int main(){
+  testParseFloat();
+  testScanner();
+  testRoundTrip();
+  testRelative();
+  testUnterminated();
+  testMalformed();
+  testMtllib();
+  testCache();
+  testView();
+  testVisitor();
+  testInterleaved();
+  return report("objLoader");
+}
@@ -0,0 +1,47 @@
+#include "Renderer.h"
+#include "test.h"
+
+#include <random>
+
+//radix sort against std::stable_sort, over one and many chunks, with shared digits skipped
+void testRadixSort(){
+  std::mt19937_64 rng(5);
+  const uint64_t masks[] = {~0ull, 0xFFFFull, 0xFF00000000000000ull, 0x8000000000FFFFFFull};
+  for(size_t n : {size_t(0), size_t(1), size_t(1000), size_t(100000)})
+    for(uint64_t mask : masks)
+      for(unsigned int threads : {1u, 4u}){
+        std::vector<uint64_t> keys(n), keyScratch;
+        std::vector<uint32_t> values(n), valueScratch;
+        std::vector<std::pair<uint64_t, uint32_t>> expect(n);
+        for(size_t i=0; i<n; i++){
+          keys[i] = (rng() & mask) | 0x0000AB0000000000ull; //one byte is the same everywhere
+          values[i] = static_cast<uint32_t>(i);
+          expect[i] = {keys[i], values[i]};
+        }
+        std::stable_sort(expect.begin(), expect.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+        Renderer::radixSort(keys, values, keyScratch, valueScratch, threads);
+        bool same = true;
+        for(size_t i=0; i<n; i++)
+          same &= keys[i] == expect[i].first && values[i] == expect[i].second;
+        CHECK(same);
+      }
+}
+
+//opaque draws group by binds and go front to back, transparent ones come last, back to front
+void testDrawKey(){
+  Renderer::Mesh opaque{}, transparent{};
+  opaque.textureID = 3;
+  transparent.transparent = true;
+  CHECK(Renderer::drawKey(opaque, 100.0f) < Renderer::drawKey(transparent, 1.0f));
+  CHECK(Renderer::drawKey(opaque, 1.0f) < Renderer::drawKey(opaque, 2.0f));
+  CHECK(Renderer::drawKey(transparent, 2.0f) < Renderer::drawKey(transparent, 1.0f));
+  Renderer::Mesh other = opaque;
+  other.textureID = 4;
+  CHECK(Renderer::drawKey(opaque, 1000.0f) < Renderer::drawKey(other, 1.0f));
+}
+
+int main(){
+  testRadixSort();
+  testDrawKey();
+  return report("renderer");
+}
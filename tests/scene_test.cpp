@@ -0,0 +1,99 @@
+#include "scene.h"
+#include "test.h"
+
+#include <random>
+#include <set>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+//frustum planes of projection * view (Gribb, Hartmann), same order as Renderer::View
+void frustumPlanes(const glm::mat4& matrix, glm::vec4* planes){
+  glm::mat4 m = glm::transpose(matrix);
+  planes[0] = m[3] + m[0];
+  planes[1] = m[3] - m[0];
+  planes[2] = m[3] + m[1];
+  planes[3] = m[3] - m[1];
+  planes[4] = m[3] + m[2];
+  planes[5] = m[3] - m[2];
+}
+
+//box is outside when its corner furthest along some plane normal is behind that plane
+bool boxVisible(const glm::vec4* planes, const glm::vec3& min, const glm::vec3& max){
+  for(int k=0; k<6; k++){
+    const glm::vec4& p = planes[k];
+    glm::vec3 far(p.x >= 0.0f ? max.x : min.x, p.y >= 0.0f ? max.y : min.y, p.z >= 0.0f ? max.z : min.z);
+    if(glm::dot(glm::vec3(p), far) + p.w < 0.0f) return false;
+  }
+  return true;
+}
+
+struct Box{
+  glm::vec3 min, max;
+  int32_t proxy = scene::null;
+};
+
+//tree cull against testing every live box, through inserts, moves and removals
+void testCull(float margin){
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<float> U(-200.0f, 200.0f), size(0.5f, 8.0f);
+  auto randomBox = [&](Box& box){
+    box.min = glm::vec3(U(rng), U(rng), U(rng));
+    box.max = box.min + glm::vec3(size(rng), size(rng), size(rng));
+  };
+  scene::Tree tree;
+  tree.margin = margin;
+  std::vector<Box> boxes(3000);
+  for(uint32_t i=0; i<boxes.size(); i++){
+    randomBox(boxes[i]);
+    boxes[i].proxy = scene::insert(tree, boxes[i].min, boxes[i].max, i);
+  }
+  CHECK(tree.leaves == boxes.size());
+
+  glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.5f, 250.0f);
+  for(int frame=0; frame<40; frame++){
+    //every frame some boxes move and some come and go
+    for(int i=0; i<100; i++){
+      Box& box = boxes[rng() % boxes.size()];
+      if(box.proxy == scene::null){
+        randomBox(box);
+        box.proxy = scene::insert(tree, box.min, box.max, static_cast<uint32_t>(&box - boxes.data()));
+      }
+      else if(i % 5 == 0){
+        scene::remove(tree, box.proxy);
+        box.proxy = scene::null;
+      }
+      else{
+        glm::vec3 step(U(rng) * 0.01f, U(rng) * 0.01f, U(rng) * 0.01f);
+        box.min += step;
+        box.max += step;
+        scene::update(tree, box.proxy, box.min, box.max);
+      }
+    }
+
+    glm::vec3 eye(U(rng) * 0.5f, U(rng) * 0.5f, U(rng) * 0.5f);
+    glm::mat4 view = glm::lookAt(eye, glm::vec3(U(rng), U(rng), U(rng)), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::vec4 planes[6];
+    frustumPlanes(projection * view, planes);
+
+    std::set<uint32_t> expect, visible;
+    for(uint32_t i=0; i<boxes.size(); i++)
+      if(boxes[i].proxy != scene::null && boxVisible(planes, boxes[i].min, boxes[i].max)) expect.insert(i);
+    size_t calls = 0;
+    scene::CullStats stats = scene::cull(tree, planes, [&](uint32_t item){
+      visible.insert(item);
+      calls++;
+    });
+    CHECK(calls == visible.size() && stats.itemsVisible == calls);
+    CHECK(!expect.empty());
+    //leaf boxes grown by margin may let a few more through, never fewer
+    if(margin == 0.0f) CHECK(visible == expect);
+    else CHECK(std::includes(visible.begin(), visible.end(), expect.begin(), expect.end()));
+    CHECK(stats.nodesTested < tree.nodes.size()); //whole subtrees are skipped
+  }
+}
+
+int main(){
+  testCull(0.0f);
+  testCull(1.0f);
+  return report("scene");
+}
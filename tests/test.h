@@ -0,0 +1,25 @@
+#pragma once
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+//failed checks are printed with their line, test exits with their count
+inline int failures = 0;
+
+#define CHECK(x) do{ \
+  if(!(x)){ \
+    std::cout << __FILE__ << ":" << __LINE__ << " failed: " #x << std::endl; \
+    failures++; \
+  } \
+}while(0)
+
+void writeFile(const std::string& path, const std::string& text){
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << text;
+}
+
+int report(const char* test){
+  std::cout << test << ": " << (failures ? std::to_string(failures) + " checks failed" : "ok") << std::endl;
+  return failures ? 1 : 0;
+}